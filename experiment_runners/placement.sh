@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+
+# Compares the PACK and SPREAD HC group placements on a local multi-node MPI setup.
+# Every node listed in the hostfile should be a separate machine (or container), otherwise
+# MPI_COMM_TYPE_SHARED sees a single node and both placements coincide.
+# Usage: HOSTFILE CORES INPUT REPETITIONS [SEED]
+
+hostfile=$1
+cores=$2
+input=$3
+repetitions=$4
+seed=${5:-0}
+
+executable=$(dirname $0)/../build/src/executables/square_root
+executable=${SQUARE_ROOT:-$executable}
+
+for placement in pack spread; do
+	for i in $(seq 1 ${repetitions}); do
+		echo -n "${placement},"
+		mpirun --hostfile ${hostfile} --map-by node -n ${cores} \
+			${executable} --placement=${placement} 0.90 ${input} $((${seed} + ${i})) | tail -n 1
+	done
+done
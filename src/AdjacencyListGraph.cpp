@@ -1,4 +1,5 @@
 #include "AdjacencyListGraph.hpp"
+#include "sorting/RadixSort.hpp"
 #include <unordered_set>
 
 void AdjacencyListGraph::addEdge(unsigned from, unsigned to, Weight weight)
@@ -31,7 +32,7 @@ unsigned AdjacencyListGraph::maxVertexID() const
 /**
  * @return The graph with singleton vertices removed and edges renamed so that it is a connected graph on [0, vertex_count)
  */
-std::unique_ptr<AdjacencyListGraph> AdjacencyListGraph::compact() const {
+std::unique_ptr<AdjacencyListGraph> AdjacencyListGraph::compact(std::vector<unsigned> * mapping_out) const {
 	std::unique_ptr<AdjacencyListGraph> result(new AdjacencyListGraph(vertex_count()));
 	// Mapping old_id -> new_id
 	std::vector<unsigned> mapping(maxVertexID() + 1, std::numeric_limits<unsigned>::max());
@@ -48,9 +49,17 @@ std::unique_ptr<AdjacencyListGraph> AdjacencyListGraph::compact() const {
 	for (auto const & edge : *parent_edges_)
 		result->addEdge(mapping.at(edge.from), mapping.at(edge.to), edge.weight);
 
+	if (mapping_out != nullptr)
+		*mapping_out = std::move(mapping);
+
 	return result;
 }
 
+unsigned AdjacencyListGraph::representative(unsigned vertex)
+{
+	return disjoint_sets_.find(vertex);
+}
+
 void AdjacencyListGraph::weaklyContractEdge(unsigned from, unsigned to)
 {
 	// std::cout << "Contracting " << from << " -- " << to << std::endl;
@@ -90,7 +99,7 @@ void AdjacencyListGraph::finalizeContractionPhase(sitmo::prng_engine * random)
 	for (auto & edge : edges_)
 		std::tie(edge.to, edge.from) = normalize(disjoint_sets_.find(edge.to),  disjoint_sets_.find(edge.from));
 
-	std::sort(edges_.begin(), edges_.end());
+	radix_sort(edges_);
 
 	EdgeList::size_type next_index = { 0 };
 
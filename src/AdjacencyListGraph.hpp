@@ -113,8 +113,14 @@ public:
 
 	/**
 	 * return The graph with singleton vertices removed and edges renamed so that it is a connected graph on [0, vertex_count)
+	 * @param [out] mapping If given, receives the old_id -> new_id mapping. Ids without edges map to std::numeric_limits<unsigned>::max()
 	 */
-	std::unique_ptr<AdjacencyListGraph> compact() const;
+	std::unique_ptr<AdjacencyListGraph> compact(std::vector<unsigned> * mapping = nullptr) const;
+
+	/**
+	 * @return The vertex that `vertex` has been contracted into
+	 */
+	unsigned representative(unsigned vertex);
 
 	/**
 	 * Contract the edge `from -- to`
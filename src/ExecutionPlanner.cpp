@@ -0,0 +1,230 @@
+#include "ExecutionPlanner.hpp"
+#include "SequentialSquareRootCut.hpp"
+#include "utils.hpp"
+#include <unistd.h>
+#include <algorithm>
+
+ExecutionPlanner::MachineConstants ExecutionPlanner::calibrate(MPI_Comm communicator, double memory_per_node) {
+	int p, rank;
+	MPI_Comm_size(communicator, &p);
+	MPI_Comm_rank(communicator, &rank);
+
+	MachineConstants constants;
+	double hops = std::max(1.0, std::ceil(std::log2(p)));
+
+	// Latency: empty-ish allreduces. An allreduce is a reduction followed by a broadcast
+	const int latency_repetitions = 50;
+	int dummy = 0, dummy_result;
+	double latency_time;
+	MPI_Barrier(communicator);
+	TimeUtils::measure<void>([&]() {
+		for (int i = 0; i < latency_repetitions; i++) {
+			MPI_Allreduce(&dummy, &dummy_result, 1, MPI_INT, MPI_SUM, communicator);
+		}
+	}, latency_time);
+
+	// Bandwidth: pipelined broadcasts of a large buffer
+	const int bandwidth_repetitions = 4;
+	const size_t bandwidth_bytes = 1 << 22;
+	std::vector<char> buffer(bandwidth_bytes, (char) rank);
+	double bandwidth_time;
+	MPI_Barrier(communicator);
+	TimeUtils::measure<void>([&]() {
+		for (int i = 0; i < bandwidth_repetitions; i++) {
+			MPI_Bcast(buffer.data(), (int) bandwidth_bytes, MPI_CHAR, 0, communicator);
+		}
+	}, bandwidth_time);
+
+	// Dense KS: a trial on a complete graph that is already at the target size
+	const unsigned dense_size = 48;
+	sitmo::prng_engine random(rank);
+	AdjacencyListGraph dense(dense_size);
+	for (unsigned i = 0; i < dense_size; i++) {
+		for (unsigned j = i + 1; j < dense_size; j++) {
+			dense.addEdge(i, j, 1 + random() % 100);
+		}
+	}
+	double dense_time;
+	TimeUtils::measure<void>([&]() {
+		SequentialSquareRootCut(&dense, &random, dense_size).compute();
+	}, dense_time);
+
+	// Sparse passes: iterated sampling of a ring with random chords down to a tiny base case
+	const unsigned sparse_size = 2048, sparse_degree = 4, sparse_target = 32;
+	AdjacencyListGraph sparse(sparse_size);
+	for (unsigned i = 0; i < sparse_size; i++) {
+		sparse.addEdge(i, (i + 1) % sparse_size, 1 + random() % 100);
+		for (unsigned j = 1; j < sparse_degree; j++) {
+			unsigned other = random() % sparse_size;
+			if (other != i) {
+				sparse.addEdge(i, other, 1 + random() % 100);
+			}
+		}
+	}
+	double sparse_edges = sparse.edge_count();
+	double sparse_time;
+	TimeUtils::measure<void>([&]() {
+		SequentialSquareRootCut(&sparse, &random, sparse_target).compute();
+	}, sparse_time);
+
+	// The slowest rank determines the schedule
+	double local_times[4] = { latency_time, bandwidth_time, dense_time, sparse_time }, times[4];
+	MPI_Allreduce(local_times, times, 4, MPI_DOUBLE, MPI_MAX, communicator);
+
+	constants.latency = times[0] / (latency_repetitions * 2 * hops);
+	constants.inverse_bandwidth = std::max(
+			times[1] / bandwidth_repetitions - hops * constants.latency,
+			std::numeric_limits<double>::epsilon()
+	) / bandwidth_bytes;
+
+	ExecutionPlanner dense_model({ 0, 0, 1, 1, 0, 1 });
+	constants.contraction_rate = dense_model.karger_stein(dense_size) / std::max(times[2], std::numeric_limits<double>::epsilon());
+
+	double sparse_base_case = dense_model.karger_stein(sparse_target) / constants.contraction_rate;
+	constants.edge_rate = sparse_edges * std::log2(double(sparse_size) / sparse_target)
+						  / std::max(times[3] - sparse_base_case, 0.1 * times[3]);
+
+	// Node memory and occupancy
+	MPI_Comm node_communicator;
+	MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_communicator);
+	int local_ranks_per_node, ranks_per_node;
+	MPI_Comm_size(node_communicator, &local_ranks_per_node);
+	MPI_Comm_free(&node_communicator);
+	MPI_Allreduce(&local_ranks_per_node, &ranks_per_node, 1, MPI_INT, MPI_MAX, communicator);
+	constants.ranks_per_node = (unsigned) ranks_per_node;
+
+	if (memory_per_node <= 0) {
+		double local_memory = double(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+		MPI_Allreduce(&local_memory, &memory_per_node, 1, MPI_DOUBLE, MPI_MIN, communicator);
+	}
+	constants.memory_per_node = memory_per_node;
+
+	return constants;
+}
+
+double ExecutionPlanner::collective(double hops, double bytes) const {
+	return hops * constants_.latency + bytes * constants_.inverse_bandwidth;
+}
+
+double ExecutionPlanner::karger_stein(double t) const {
+	double log_t = std::max(1.0, std::log2(t));
+	return t * t * log_t * log_t / constants_.contraction_rate;
+}
+
+ExecutionPlanner::Plan ExecutionPlanner::lowConcurrency(unsigned n, unsigned m, unsigned p, double base_case_multiplier, unsigned trials) const {
+	SquareRootCut model(base_case_multiplier);
+	double t = model.intermediate_size(n, m);
+	double hops = std::max(1.0, std::ceil(std::log2(p)));
+	double edge_bytes = double(m) * sizeof(AdjacencyListGraph::Edge);
+
+	double trial = double(m) * std::max(1.0, std::log2(n / t)) / constants_.edge_rate + karger_stein(t);
+
+	Plan plan;
+	plan.variant = SquareRootCut::LOW_CONCURRENCY;
+	plan.group_size = 1;
+	plan.base_case_multiplier = base_case_multiplier;
+	plan.trials = trials;
+	plan.predicted_time = collective(hops, edge_bytes)
+						  + std::ceil(double(trials) / p) * trial
+						  + collective(hops, 0);
+	// The broadcast graph and the copy used by the running trial
+	plan.predicted_memory = constants_.ranks_per_node * 2 * edge_bytes;
+
+	return plan;
+}
+
+ExecutionPlanner::Plan ExecutionPlanner::highConcurrency(unsigned n, unsigned m, unsigned p, double base_case_multiplier, unsigned trials, unsigned group_size) const {
+	SquareRootCut model(base_case_multiplier);
+	double t = model.intermediate_size(n, m);
+	double g = group_size;
+	double group_count = p / group_size;
+	double slice_bytes = double(m) / g * sizeof(AdjacencyListGraph::Edge);
+	double group_hops = std::max(1.0, std::log2(g));
+
+	double time = collective(std::max(1.0, std::ceil(std::log2(group_count))), slice_bytes);
+
+	// ISS: every round contracts by about n^(epsilon/2)
+	double rounds = std::max(1.0, std::ceil(std::log(n / t) / (epsilon_ / 2 * std::log(std::max(2u, n)))));
+	double sample = std::pow(double(n), 1 + epsilon_ / 2);
+	time += rounds * (collective(group_hops, sample * sizeof(AdjacencyListGraph::Edge))
+					  + sample / constants_.edge_rate
+					  + collective(group_hops, double(n) * sizeof(unsigned))
+					  + double(m) / g / constants_.edge_rate);
+
+	// Reduce: local sort, the all-to-all of both triangles and the dense slice
+	double local_edges = double(m) / g;
+	time += local_edges * std::max(1.0, std::log2(local_edges)) / constants_.edge_rate
+			+ collective(g, 2 * slice_bytes)
+			+ t * t / g / constants_.edge_rate;
+
+	// RC: every level halves the group and shrinks the graph by sqrt(2)
+	double v = t;
+	for (double level_group = g; level_group > 1; level_group /= 2) {
+		double entries = v * v / level_group;
+		time += 6 * entries / constants_.edge_rate
+				+ collective(level_group, entries * sizeof(long))
+				+ collective(1, entries * sizeof(long));
+		v /= std::sqrt(2.0);
+	}
+	time += karger_stein(v);
+
+	time += collective(std::max(1.0, std::ceil(std::log2(p))), 0);
+
+	Plan plan;
+	plan.variant = SquareRootCut::HIGH_CONCURRENCY;
+	plan.group_size = group_size;
+	plan.base_case_multiplier = base_case_multiplier;
+	plan.trials = (unsigned) group_count;
+	plan.predicted_time = time;
+	// Slice with the sorting buffers, dense slice with the RC auxiliary and duplicate buffers
+	plan.predicted_memory = constants_.ranks_per_node * (3 * slice_bytes + 3 * t * t / g * sizeof(long));
+
+	return plan;
+}
+
+std::vector<ExecutionPlanner::Plan> ExecutionPlanner::candidates(unsigned n, unsigned m, unsigned p, double success_probability) const {
+	std::vector<Plan> plans;
+
+	for (double base_case_multiplier : { 1.0, 1.5, 2.0, 3.0, 4.0 }) {
+		// Once the base case is the whole graph, larger multipliers only (wrongly) reduce the number of trials
+		if (!plans.empty() && SquareRootCut(plans.back().base_case_multiplier).intermediate_size(n, m) == n) {
+			break;
+		}
+
+		unsigned trials = SquareRootCut(base_case_multiplier).numberOfTrials(n, m, success_probability);
+
+		plans.push_back(lowConcurrency(n, m, p, base_case_multiplier, trials));
+
+		for (unsigned group_size = SquareRootCut::group_size_; group_size * trials <= p; group_size *= 2) {
+			plans.push_back(highConcurrency(n, m, p, base_case_multiplier, trials, group_size));
+		}
+	}
+
+	plans.erase(std::remove_if(plans.begin(), plans.end(), [&](const Plan & plan) {
+		return plan.predicted_memory > constants_.memory_per_node;
+	}), plans.end());
+
+	std::stable_sort(plans.begin(), plans.end(), [](const Plan & a, const Plan & b) {
+		return a.predicted_time < b.predicted_time;
+	});
+
+	return plans;
+}
+
+ExecutionPlanner::Plan ExecutionPlanner::plan(unsigned n, unsigned m, unsigned p, double success_probability) const {
+	std::vector<Plan> plans = candidates(n, m, p, success_probability);
+
+	if (!plans.empty()) {
+		return plans.front();
+	}
+
+	// Nothing fits -- use what SquareRootCut would pick on its own
+	SquareRootCut model(2);
+	unsigned trials = model.numberOfTrials(n, m, success_probability);
+	if (p < SquareRootCut::group_size_ * trials) {
+		return lowConcurrency(n, m, p, 2, trials);
+	} else {
+		unsigned group_size = (unsigned) std::pow(2, std::floor(std::log2(p / trials)));
+		return highConcurrency(n, m, p, 2, trials, group_size);
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef PARALLEL_MINIMUM_CUT_EXECUTIONPLANNER_HPP
+#define PARALLEL_MINIMUM_CUT_EXECUTIONPLANNER_HPP
+
+#include "mpi.h"
+#include "SquareRootCut.hpp"
+#include <vector>
+
+/**
+ * Chooses the SquareRootCut configuration (variant, HC group size and base case multiplier) with the lowest
+ * predicted running time.
+ *
+ * The prediction is a latency-bandwidth model of the collectives combined with the calibrated throughput
+ * of the local kernels:
+ *  - LC: one broadcast of the whole graph, then ceil(trials / p) sequential sqrt(m)-cut trials per rank
+ *  - HC: slice broadcast, ISS rounds, reduce and log2(group size) levels of RC, ending in a sequential base case
+ *
+ * Configurations that would not fit into the memory of a node are discarded.
+ */
+class ExecutionPlanner {
+public:
+	struct MachineConstants {
+		/** Seconds per message hop of a collective */
+		double latency;
+		/** Seconds per byte moved by a collective */
+		double inverse_bandwidth;
+		/** Dense KS work units (t^2 log^2 t for a t-vertex graph) per second and core */
+		double contraction_rate;
+		/** Edges scanned per second and core by the sampling and contraction passes */
+		double edge_rate;
+		/** Bytes available to the ranks of one node */
+		double memory_per_node;
+		unsigned ranks_per_node;
+	};
+
+	struct Plan {
+		SquareRootCut::Variant variant;
+		/** Only meaningful for HIGH_CONCURRENCY */
+		unsigned group_size;
+		double base_case_multiplier;
+		unsigned trials;
+		double predicted_time, predicted_memory;
+	};
+
+	ExecutionPlanner(MachineConstants constants) : constants_(constants)
+	{}
+
+	/**
+	 * Collective. Measures the machine constants with a short micro-run. All ranks obtain identical constants
+	 * (the slowest measurement wins), so plans computed from them agree across the communicator.
+	 *
+	 * \param memory_per_node Bytes per node, or 0 to query the physical memory of the nodes
+	 */
+	static MachineConstants calibrate(MPI_Comm communicator, double memory_per_node = 0);
+
+	/**
+	 * \return All feasible configurations for the given instance, fastest first
+	 */
+	std::vector<Plan> candidates(unsigned n, unsigned m, unsigned p, double success_probability) const;
+
+	/**
+	 * \return The fastest feasible configuration. Falls back to the default heuristics when nothing fits
+	 *         into memory.
+	 */
+	Plan plan(unsigned n, unsigned m, unsigned p, double success_probability) const;
+
+	const MachineConstants & constants() const {
+		return constants_;
+	}
+
+protected:
+	MachineConstants constants_;
+
+	/** Mirrors WeightedIteratedSparseSampling */
+	const double epsilon_ = 0.1;
+
+	double collective(double hops, double bytes) const;
+
+	double karger_stein(double t) const;
+
+	Plan lowConcurrency(unsigned n, unsigned m, unsigned p, double base_case_multiplier, unsigned trials) const;
+
+	Plan highConcurrency(unsigned n, unsigned m, unsigned p, double base_case_multiplier, unsigned trials, unsigned group_size) const;
+};
+
+
+#endif //PARALLEL_MINIMUM_CUT_EXECUTIONPLANNER_HPP
@@ -93,17 +93,17 @@ public:
 	 * Send our slice to equivalent ranks in other groups
 	 */
 	void broadcastSlice(MPI_Comm equivalence_comm) {
-		unsigned slice_size = edges_slice_.size();
+		size_t slice_size = edges_slice_.size();
 
 		MPI::Bcast(
 				&slice_size,
 				1,
-				MPI_UNSIGNED,
+				MPI_SIZE_T,
 				0,
 				equivalence_comm
 		);
 
-		MPI::Bcast(
+		MPI::Bcast_large(
 				edges_slice_.data(),
 				edges_slice_.size(),
 				mpi_edge_t_,
@@ -116,19 +116,19 @@ public:
 	 * Receive our slice
 	 */
 	void receiveSlice(MPI_Comm equivalence_comm) {
-		unsigned slice_size;
+		size_t slice_size;
 
 		MPI::Bcast(
 				&slice_size,
 				1,
-				MPI_UNSIGNED,
+				MPI_SIZE_T,
 				0,
 				equivalence_comm
 		);
 
 		edges_slice_.resize(slice_size);
 
-		MPI::Bcast(
+		MPI::Bcast_large(
 				edges_slice_.data(),
 				edges_slice_.size(),
 				mpi_edge_t_,
@@ -228,16 +228,16 @@ public:
 	 * @param edge_count
 	 * @return The edge sample
 	 */
-	virtual std::vector<EdgeT> sample(unsigned edge_count) = 0;
+	virtual std::vector<EdgeT> sample(size_t edge_count) = 0;
 
-	unsigned initiateSampling(std::vector<int> edges_per_processor, std::vector<unsigned> & vertex_map) {
-		unsigned number_of_edges_to_sample = std::accumulate(edges_per_processor.begin(), edges_per_processor.end(), 0u);
+	unsigned initiateSampling(std::vector<size_t> edges_per_processor, std::vector<unsigned> & vertex_map) {
+		size_t number_of_edges_to_sample = std::accumulate(edges_per_processor.begin(), edges_per_processor.end(), size_t(0));
 
 		/**
 		 * Scatter sampling requests
 		 */
-		int edges_to_sample_locally;
-		MPI::Scatter(edges_per_processor.data(), 1, MPI_INT, &edges_to_sample_locally, 1, MPI_INT, 0, communicator_);
+		size_t edges_to_sample_locally;
+		MPI::Scatter(edges_per_processor.data(), 1, MPI_SIZE_T, &edges_to_sample_locally, 1, MPI_SIZE_T, 0, communicator_);
 
 		/**
 		 * Take part in sampling
@@ -250,18 +250,12 @@ public:
 		// Allocate space
 		std::vector<EdgeT> global_samples(number_of_edges_to_sample);
 		// Calculate displacement vector
-		std::vector<int> relative_displacements(edges_per_processor);
-		relative_displacements.insert(relative_displacements.begin(), 0); // Start at offset zero
-		relative_displacements.pop_back(); // Last element not needed
-
-		std::vector<int> displacements;
-		std::partial_sum(relative_displacements.begin(), relative_displacements.end(), std::back_inserter(displacements));
+		std::vector<size_t> displacements = MPIUtils::prefix_offsets(edges_per_processor);
 
 		assert(master());
-		MPI::Gatherv(
+		MPI::Gatherv_large(
 				samples.data(),
 				edges_to_sample_locally,
-				mpi_edge_t_,
 				global_samples.data(),
 				edges_per_processor.data(),
 				displacements.data(),
@@ -298,15 +292,14 @@ public:
 	 * Match `initiateSampling` at non-root nodes
 	 */
 	void acceptSamplingRequest() {
-		int edges_to_sample_locally;
-		MPI::Scatter(nullptr, 1, MPI_INT, &edges_to_sample_locally, 1, MPI_INT, 0, communicator_);
+		size_t edges_to_sample_locally;
+		MPI::Scatter(nullptr, 1, MPI_SIZE_T, &edges_to_sample_locally, 1, MPI_SIZE_T, 0, communicator_);
 
 		std::vector<EdgeT> samples = sample(edges_to_sample_locally);
 
-		MPI::Gatherv(
+		MPI::Gatherv_large(
 				samples.data(),
 				edges_to_sample_locally,
-				mpi_edge_t_,
 				nullptr,
 				nullptr,
 				nullptr,
@@ -1,3 +1,231 @@
 #include "MPICollector.hpp"
+#include <climits>
+#include <vector>
+#include <algorithm>
 
-double MPI::total = 0;
\ No newline at end of file
+double MPI::total = 0;
+
+namespace {
+	const size_t chunk_elements = INT_MAX;
+
+	bool fitsInt(size_t value) {
+		return value <= size_t(INT_MAX);
+	}
+
+	bool fitsInt(const size_t * values, int count) {
+		return std::all_of(values, values + count, [](size_t value) { return fitsInt(value); });
+	}
+
+	std::vector<int> toInt(const size_t * values, int count) {
+		return std::vector<int>(values, values + count);
+	}
+
+	char * at(void * buffer, size_t displacement, MPI_Aint extent) {
+		return static_cast<char *>(buffer) + displacement * extent;
+	}
+
+	const char * at(const void * buffer, size_t displacement, MPI_Aint extent) {
+		return static_cast<const char *>(buffer) + displacement * extent;
+	}
+
+	MPI_Aint extentOf(MPI_Datatype type) {
+		MPI_Aint lower_bound, extent;
+		MPI_Type_get_extent(type, &lower_bound, &extent);
+		return extent;
+	}
+
+	/**
+	 * Non-blocking chunked transfers of a block, one message per chunk
+	 */
+	void sendChunked(const void * buffer, size_t count, MPI_Datatype type, int peer, MPI_Comm comm, std::vector<MPI_Request> & requests) {
+		MPI_Aint extent = extentOf(type);
+		for (size_t offset = 0, tag = 0; offset < count; offset += chunk_elements, tag++) {
+			requests.emplace_back();
+			MPI_Isend(at(buffer, offset, extent), (int) std::min(chunk_elements, count - offset), type, peer, (int) tag, comm, &requests.back());
+		}
+	}
+
+	void receiveChunked(void * buffer, size_t count, MPI_Datatype type, int peer, MPI_Comm comm, std::vector<MPI_Request> & requests) {
+		MPI_Aint extent = extentOf(type);
+		for (size_t offset = 0, tag = 0; offset < count; offset += chunk_elements, tag++) {
+			requests.emplace_back();
+			MPI_Irecv(at(buffer, offset, extent), (int) std::min(chunk_elements, count - offset), type, peer, (int) tag, comm, &requests.back());
+		}
+	}
+
+	void waitAll(std::vector<MPI_Request> & requests) {
+		MPI_Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+	}
+
+	int bcastLarge(void * buffer, size_t count, MPI_Datatype type, int root, MPI_Comm comm) {
+#if MPI_VERSION >= 4
+		return MPI_Bcast_c(buffer, (MPI_Count) count, type, root, comm);
+#else
+		MPI_Aint extent = extentOf(type);
+		int result = MPI_SUCCESS;
+		for (size_t offset = 0; offset < count && result == MPI_SUCCESS; offset += chunk_elements) {
+			result = MPI_Bcast(at(buffer, offset, extent), (int) std::min(chunk_elements, count - offset), type, root, comm);
+		}
+		return result;
+#endif
+	}
+
+	int gathervLarge(const void * send_buffer, size_t send_count, void * recv_buffer,
+					 const size_t * recv_counts, const size_t * displacements, MPI_Datatype type, int root, MPI_Comm comm) {
+		int p, rank;
+		MPI_Comm_size(comm, &p);
+		MPI_Comm_rank(comm, &rank);
+
+#if MPI_VERSION >= 4
+		std::vector<MPI_Count> counts;
+		std::vector<MPI_Aint> offsets;
+		if (rank == root) {
+			counts.assign(recv_counts, recv_counts + p);
+			offsets.assign(displacements, displacements + p);
+		}
+		return MPI_Gatherv_c(send_buffer, (MPI_Count) send_count, type, recv_buffer, counts.data(), offsets.data(), type, root, comm);
+#else
+		// Only the root knows all the counts, so the choice has to be agreed upon
+		int local_fits = fitsInt(send_count) && (rank != root || (fitsInt(recv_counts, p) && fitsInt(displacements, p))),
+			fits;
+		MPI_Allreduce(&local_fits, &fits, 1, MPI_INT, MPI_LAND, comm);
+
+		if (fits) {
+			std::vector<int> counts, offsets;
+			if (rank == root) {
+				counts = toInt(recv_counts, p);
+				offsets = toInt(displacements, p);
+			}
+			return MPI_Gatherv(send_buffer, (int) send_count, type, recv_buffer, counts.data(), offsets.data(), type, root, comm);
+		}
+
+		std::vector<MPI_Request> requests;
+		MPI_Aint extent = extentOf(type);
+		if (rank == root) {
+			for (int i = 0; i < p; i++) {
+				if (i == rank) {
+					std::copy(at(send_buffer, 0, extent), at(send_buffer, send_count, extent), at(recv_buffer, displacements[i], extent));
+				} else {
+					receiveChunked(at(recv_buffer, displacements[i], extent), recv_counts[i], type, i, comm, requests);
+				}
+			}
+		} else {
+			sendChunked(send_buffer, send_count, type, root, comm, requests);
+		}
+		waitAll(requests);
+		return MPI_SUCCESS;
+#endif
+	}
+
+	int allgathervLarge(const void * send_buffer, size_t send_count, void * recv_buffer,
+						const size_t * recv_counts, const size_t * displacements, MPI_Datatype type, MPI_Comm comm) {
+		int p;
+		MPI_Comm_size(comm, &p);
+
+#if MPI_VERSION >= 4
+		std::vector<MPI_Count> counts(recv_counts, recv_counts + p);
+		std::vector<MPI_Aint> offsets(displacements, displacements + p);
+		return MPI_Allgatherv_c(send_buffer, (MPI_Count) send_count, type, recv_buffer, counts.data(), offsets.data(), type, comm);
+#else
+		// Everyone knows all the counts, no agreement needed
+		if (fitsInt(recv_counts, p) && fitsInt(displacements, p)) {
+			std::vector<int> counts = toInt(recv_counts, p),
+					offsets = toInt(displacements, p);
+			return MPI_Allgatherv(send_buffer, (int) send_count, type, recv_buffer, counts.data(), offsets.data(), type, comm);
+		}
+
+		int rank;
+		MPI_Comm_rank(comm, &rank);
+		MPI_Aint extent = extentOf(type);
+		std::copy(at(send_buffer, 0, extent), at(send_buffer, send_count, extent), at(recv_buffer, displacements[rank], extent));
+
+		int result = MPI_SUCCESS;
+		for (int i = 0; i < p && result == MPI_SUCCESS; i++) {
+			result = bcastLarge(at(recv_buffer, displacements[i], extent), recv_counts[i], type, i, comm);
+		}
+		return result;
+#endif
+	}
+
+	int alltoallvLarge(const void * send_buffer, const size_t * send_counts, const size_t * send_displacements,
+					   void * recv_buffer, const size_t * recv_counts, const size_t * recv_displacements,
+					   MPI_Datatype type, MPI_Comm comm) {
+		int p, rank;
+		MPI_Comm_size(comm, &p);
+		MPI_Comm_rank(comm, &rank);
+
+#if MPI_VERSION >= 4
+		std::vector<MPI_Count> scounts(send_counts, send_counts + p), rcounts(recv_counts, recv_counts + p);
+		std::vector<MPI_Aint> soffsets(send_displacements, send_displacements + p), roffsets(recv_displacements, recv_displacements + p);
+		return MPI_Alltoallv_c(send_buffer, scounts.data(), soffsets.data(), type, recv_buffer, rcounts.data(), roffsets.data(), type, comm);
+#else
+		int local_fits = fitsInt(send_counts, p) && fitsInt(send_displacements, p) && fitsInt(recv_counts, p) && fitsInt(recv_displacements, p),
+			fits;
+		MPI_Allreduce(&local_fits, &fits, 1, MPI_INT, MPI_LAND, comm);
+
+		if (fits) {
+			std::vector<int> scounts = toInt(send_counts, p), soffsets = toInt(send_displacements, p),
+					rcounts = toInt(recv_counts, p), roffsets = toInt(recv_displacements, p);
+			return MPI_Alltoallv(send_buffer, scounts.data(), soffsets.data(), type, recv_buffer, rcounts.data(), roffsets.data(), type, comm);
+		}
+
+		std::vector<MPI_Request> requests;
+		MPI_Aint extent = extentOf(type);
+		for (int i = 0; i < p; i++) {
+			if (i == rank) {
+				std::copy(at(send_buffer, send_displacements[i], extent),
+						  at(send_buffer, send_displacements[i] + send_counts[i], extent),
+						  at(recv_buffer, recv_displacements[i], extent));
+			} else {
+				receiveChunked(at(recv_buffer, recv_displacements[i], extent), recv_counts[i], type, i, comm, requests);
+				sendChunked(at(send_buffer, send_displacements[i], extent), send_counts[i], type, i, comm, requests);
+			}
+		}
+		waitAll(requests);
+		return MPI_SUCCESS;
+#endif
+	}
+
+	int exchangeLarge(const void * send_buffer, const std::vector<int> & destinations, const size_t * send_counts, const size_t * send_displacements,
+					  void * recv_buffer, const std::vector<int> & sources, const size_t * recv_counts, const size_t * recv_displacements,
+					  MPI_Datatype type, MPI_Comm comm) {
+		std::vector<MPI_Request> requests;
+		MPI_Aint extent = extentOf(type);
+
+		for (size_t i = 0; i < sources.size(); i++) {
+			receiveChunked(at(recv_buffer, recv_displacements[i], extent), recv_counts[i], type, sources[i], comm, requests);
+		}
+		for (size_t i = 0; i < destinations.size(); i++) {
+			sendChunked(at(send_buffer, send_displacements[i], extent), send_counts[i], type, destinations[i], comm, requests);
+		}
+
+		waitAll(requests);
+		return MPI_SUCCESS;
+	}
+}
+
+int MPI::Bcast_large(void * buffer, size_t count, MPI_Datatype type, int root, MPI_Comm comm) {
+	return wrap<int>(bcastLarge, buffer, count, type, root, comm);
+}
+
+int MPI::Gatherv_large(const void * send_buffer, size_t send_count, void * recv_buffer,
+					   const size_t * recv_counts, const size_t * displacements, MPI_Datatype type, int root, MPI_Comm comm) {
+	return wrap<int>(gathervLarge, send_buffer, send_count, recv_buffer, recv_counts, displacements, type, root, comm);
+}
+
+int MPI::Allgatherv_large(const void * send_buffer, size_t send_count, void * recv_buffer,
+						  const size_t * recv_counts, const size_t * displacements, MPI_Datatype type, MPI_Comm comm) {
+	return wrap<int>(allgathervLarge, send_buffer, send_count, recv_buffer, recv_counts, displacements, type, comm);
+}
+
+int MPI::Alltoallv_large(const void * send_buffer, const size_t * send_counts, const size_t * send_displacements,
+						 void * recv_buffer, const size_t * recv_counts, const size_t * recv_displacements,
+						 MPI_Datatype type, MPI_Comm comm) {
+	return wrap<int>(alltoallvLarge, send_buffer, send_counts, send_displacements, recv_buffer, recv_counts, recv_displacements, type, comm);
+}
+
+int MPI::Exchange_large(const void * send_buffer, const std::vector<int> & destinations, const size_t * send_counts, const size_t * send_displacements,
+						void * recv_buffer, const std::vector<int> & sources, const size_t * recv_counts, const size_t * recv_displacements,
+						MPI_Datatype type, MPI_Comm comm) {
+	return wrap<int>(exchangeLarge, send_buffer, destinations, send_counts, send_displacements, recv_buffer, sources, recv_counts, recv_displacements, type, comm);
+}
@@ -3,6 +3,7 @@
 
 #include <mpi.h>
 #include "utils.hpp"
+#include <vector>
 
 /**
  * Stubs out MPI operations with profiled ones. After this, I'm headed to industry.
@@ -14,6 +15,12 @@
 	return wrap<int>(MPI_ ## FUNCTION, std::forward<Args>(args)...); \
 	}
 
+// Element counts are size_t throughout; this is the matching datatype for exchanging them
+#ifndef MPI_SIZE_T
+#define MPI_SIZE_T MPI_UNSIGNED_LONG
+static_assert(sizeof(size_t) == sizeof(unsigned long), "MPI_SIZE_T assumes size_t is unsigned long");
+#endif
+
 namespace MPI {
 	extern double total;
 
@@ -49,6 +56,38 @@ namespace MPI {
 	MPI_WRAP(Type_commit);
 	MPI_WRAP(Ibsend);
 	MPI_WRAP(Type_free);
+
+	/*
+	 * Large-count collectives: counts and displacements are size_t (in elements of `type`, which is used on both
+	 * sides). With MPI-4 they map to the `_c` variants. Otherwise, the regular collective is used when all the
+	 * counts and displacements fit into an int, and chunked transfers of at most INT_MAX elements when they do not.
+	 *
+	 * Like the wrappers above, they accumulate their time in MPI::total.
+	 */
+
+	int Bcast_large(void * buffer, size_t count, MPI_Datatype type, int root, MPI_Comm comm);
+
+	/**
+	 * \param recv_counts,displacements Only significant at the root
+	 */
+	int Gatherv_large(const void * send_buffer, size_t send_count, void * recv_buffer,
+					  const size_t * recv_counts, const size_t * displacements, MPI_Datatype type, int root, MPI_Comm comm);
+
+	int Allgatherv_large(const void * send_buffer, size_t send_count, void * recv_buffer,
+						 const size_t * recv_counts, const size_t * displacements, MPI_Datatype type, MPI_Comm comm);
+
+	int Alltoallv_large(const void * send_buffer, const size_t * send_counts, const size_t * send_displacements,
+						void * recv_buffer, const size_t * recv_counts, const size_t * recv_displacements,
+						MPI_Datatype type, MPI_Comm comm);
+
+	/**
+	 * Sparse all-to-all by point-to-point messages: sends send_counts[i] elements to destinations[i] and receives
+	 * recv_counts[i] elements from sources[i]. Only the listed peers communicate, so both sides have to know
+	 * each other.
+	 */
+	int Exchange_large(const void * send_buffer, const std::vector<int> & destinations, const size_t * send_counts, const size_t * send_displacements,
+					   void * recv_buffer, const std::vector<int> & sources, const size_t * recv_counts, const size_t * recv_displacements,
+					   MPI_Datatype type, MPI_Comm comm);
 }
 
 #endif //PARALLEL_MINIMUM_CUT_MPICOLLECTOR_HPP
@@ -18,6 +18,13 @@ struct MPIDatatype<int> {
 	}
 };
 
+template <>
+struct MPIDatatype<long> {
+	static MPI_Datatype constructType() {
+		return MPI_LONG;
+	}
+};
+
 template<>
 struct MPIDatatype<AdjacencyListGraph::Weight> {
 	static MPI_Datatype constructType() {
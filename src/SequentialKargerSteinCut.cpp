@@ -8,8 +8,11 @@ AdjacencyListGraph::Weight SequentialKargerSteinCut::compute() {
     // (Could rewrite KS using the new graph class and the iterated sampling we have for the sqrt cut)
     long m = graph_->edge_count();
     
-    stack_allocator allocator(0);
-    array<edge<AdjacencyListGraph::Weight>> ks_edges = allocator.allocate<edge<AdjacencyListGraph::Weight>>(m);
+    // The edges go to the stack of this thread, which minimum_cut uses as well, so repeated calls (e.g. the base cases
+    // of the iterated sampling) reuse its memory
+    stack_allocator * stack = comincut::thread_stack();
+    stack_state saved_stack_state = stack->enter();
+    array<edge<AdjacencyListGraph::Weight>> ks_edges = stack->allocate<edge<AdjacencyListGraph::Weight>>(m);
     
     for (unsigned i { 0 }; i < m; i++) {
         edge<AdjacencyListGraph::Weight> e;
@@ -22,6 +25,7 @@ AdjacencyListGraph::Weight SequentialKargerSteinCut::compute() {
 
     AdjacencyListGraph::Weight ks_min = comincut::minimum_cut(&ks_graph, success_probability_, seed_);
     
+    stack->leave(saved_stack_state);
 
     return ks_min;
 }
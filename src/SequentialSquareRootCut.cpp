@@ -18,6 +18,65 @@ AdjacencyListGraph::Weight SequentialSquareRootCut::compute() {
 	return ks_min;
 }
 
+AdjacencyListGraph::Weight SequentialSquareRootCut::compute(TrialState & state) {
+	unsigned vertex_count = graph_->vertex_count();
+
+	if (target_size_ < vertex_count) {
+		iteratedSampling(target_size_);
+	}
+
+	std::vector<unsigned> mapping;
+	state.contracted = graph_->compact(&mapping);
+
+	state.representatives.resize(vertex_count);
+	for (unsigned vertex { 0 }; vertex < vertex_count; vertex++) {
+		unsigned representative = graph_->representative(vertex);
+		state.representatives[vertex] = representative < mapping.size() ? mapping[representative] : std::numeric_limits<unsigned>::max();
+	}
+
+	SequentialKargerSteinCut ks_cut(state.contracted.get(), random_->operator()());
+	state.weight = ks_cut.compute();
+
+	return state.weight;
+}
+
+bool SequentialSquareRootCut::update(TrialState & state, AdjacencyListGraph::EdgeList const & edges, sitmo::prng_engine * random) {
+	bool crossing = false;
+
+	for (auto const & edge : edges) {
+		if (edge.from >= state.representatives.size() || edge.to >= state.representatives.size())
+			return false;
+
+		unsigned from = state.representatives[edge.from],
+				to = state.representatives[edge.to];
+
+		if (from == std::numeric_limits<unsigned>::max() || to == std::numeric_limits<unsigned>::max())
+			return false;
+
+		if (from != to) {
+			state.contracted->addEdge(from, to, edge.weight);
+			crossing = true;
+		}
+	}
+
+	if (crossing) {
+		// Merge the new parallel edges. Compacting afterwards restores the normalized form KS expects and may rename the vertices
+		state.contracted->finalizeContractionPhase(random);
+
+		std::vector<unsigned> mapping;
+		state.contracted = state.contracted->compact(&mapping);
+		for (auto & representative : state.representatives) {
+			if (representative != std::numeric_limits<unsigned>::max())
+				representative = mapping.at(representative);
+		}
+
+		SequentialKargerSteinCut ks_cut(state.contracted.get(), random->operator()());
+		state.weight = ks_cut.compute();
+	}
+
+	return true;
+}
+
 void SequentialSquareRootCut::iteratedSampling(unsigned final_size) {
 	assert(graph_->edge_count() >= graph_->vertex_count() - 1);
 	assert(graph_->vertex_count() >= final_size);
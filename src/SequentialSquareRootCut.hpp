@@ -18,6 +18,16 @@ class SequentialSquareRootCut {
 	unsigned int target_size_;
 
 public:
+	/**
+	 * What is left of a trial after the sampling: enough to redo the base case when edges are inserted
+	 */
+	struct TrialState {
+		/** Original vertex -> vertex of `contracted`, std::numeric_limits<unsigned>::max() if it has no edges */
+		std::vector<unsigned> representatives;
+		std::unique_ptr<AdjacencyListGraph> contracted;
+		AdjacencyListGraph::Weight weight;
+	};
+
 	SequentialSquareRootCut(AdjacencyListGraph * graph, sitmo::prng_engine * random, unsigned int target_size) :
 			graph_(graph), random_(random), target_size_(target_size) {
 		
@@ -25,6 +35,19 @@ public:
 
 	AdjacencyListGraph::Weight compute();
 
+	/**
+	 * Same as compute(), but keeps the trial in `state`
+	 */
+	AdjacencyListGraph::Weight compute(TrialState & state);
+
+	/**
+	 * Apply inserted edges to a finished trial. Edges within a contracted vertex do not cross any cut the trial
+	 * can find, so the base case is only redone if some edge connects two contracted vertices.
+	 *
+	 * \return false if the trial cannot represent the edges (an endpoint is unknown to the contraction)
+	 */
+	static bool update(TrialState & state, AdjacencyListGraph::EdgeList const & edges, sitmo::prng_engine * random);
+
 protected:
     
 	void iteratedSampling(unsigned final_size);
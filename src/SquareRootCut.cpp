@@ -3,12 +3,18 @@
 #include "SequentialKargerSteinCut.hpp"
 #include "karger-stein/co_mincut.h"
 #include <limits>
+#include <stdexcept>
 #include "recursive-contract/recursive_contract.hpp"
+#include "recursive-contract/sparse_recursive_contract.hpp"
 #include "utils.hpp"
 #include "MPICollector.hpp"
 #include "FileIteratedSampling.hpp"
 
 bool SquareRootCut::lowConcurrency(unsigned vertex_count, unsigned edge_count, double success_probability) const {
+	if (variant_overridden_) {
+		return variant_override_ == LOW_CONCURRENCY;
+	}
+
 	return processors() < group_size_ * numberOfTrials(vertex_count, edge_count, success_probability);
 }
 
@@ -26,7 +32,7 @@ SquareRootCut::Result SquareRootCut::runMaster(GraphInputIterator & input, doubl
 
 void SquareRootCut::runWorker(GraphInputIterator & input, double success_probability, uint32_t seed) {
 	vertex_count_ = input.vertexCount();
-	initial_edge_count_ = initialEdgeCount();
+	initial_edge_count_ = input.edgeCount();
 
 	if (lowConcurrency(input.vertexCount(), input.edgeCount(), success_probability)) {
 		runLowConcurrencyWorker();
@@ -69,6 +75,35 @@ unsigned SquareRootCut::intermediate_size(unsigned n, unsigned m) const {
 	}
 }
 
+int SquareRootCut::nodeMajorPosition() const {
+	MPI_Comm node_communicator;
+	MPI_Comm_split_type(communicator_, MPI_COMM_TYPE_SHARED, rank_, MPI_INFO_NULL, &node_communicator);
+
+	// The lowest rank on the node identifies it
+	int node_id = rank_;
+	MPI_Bcast(&node_id, 1, MPI_INT, 0, node_communicator);
+	MPI_Comm_free(&node_communicator);
+
+	std::vector<int> node_ids(p_);
+	MPI_Allgather(&node_id, 1, MPI_INT, node_ids.data(), 1, MPI_INT, communicator_);
+
+	int position = 0;
+	for (int i = 0; i < p_; i++) {
+		if ((node_ids.at(i) < node_id) || (node_ids.at(i) == node_id && i < rank_)) {
+			position++;
+		}
+	}
+
+	return position;
+}
+
+std::unique_ptr<TrialCheckpoint> SquareRootCut::openCheckpoint(std::string fingerprint) const {
+	if (checkpoint_directory_.empty()) {
+		return nullptr;
+	}
+	return std::unique_ptr<TrialCheckpoint>(new TrialCheckpoint(checkpoint_directory_, rank_, fingerprint, checkpoint_interval_));
+}
+
 double SquareRootCut::cPrime(double success_probability) const {
 	return double(1) / (1 - success_probability);
 }
@@ -130,11 +165,23 @@ SquareRootCut::Result SquareRootCut::runLowConcurrencyMaster(GraphInputIterator
 
 		unsigned t = intermediate_size(vertex_count, edge_count);
 
-		for (unsigned i{0}; i < trials; i++) {
+		std::unique_ptr<TrialCheckpoint> checkpoint = openCheckpoint(
+				"low " + std::to_string(vertex_count) + " " + std::to_string(edge_count) + " " + std::to_string(seed)
+				+ " " + std::to_string(trials) + " " + std::to_string(p_));
+		unsigned first_trial = 0;
+		if (checkpoint && restart_) {
+			checkpoint->load(first_trial, local_min, &engine);
+		}
+
+		for (unsigned i{first_trial}; i < trials; i++) {
 			TimeUtils::profile<void>([&]() {
 				local_min = std::min(local_min, SequentialSquareRootCut(
 						std::make_shared<AdjacencyListGraph>(AdjacencyListGraph(g)).get(), &engine, t).compute());
 			}, "local_trial");
+
+			if (checkpoint && (checkpoint->due() || i + 1 == trials)) {
+				checkpoint->save(i + 1, local_min, &engine);
+			}
 		}
 
 		MPI::Reduce(&local_min, &result.weight, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
@@ -175,8 +222,20 @@ void SquareRootCut::runLowConcurrencyWorker() {
 
 	unsigned t = intermediate_size(vertex_count, edge_count);
 
-	for (unsigned i { 0 }; i < trials; i++) {
+	std::unique_ptr<TrialCheckpoint> checkpoint = openCheckpoint(
+			"low " + std::to_string(vertex_count) + " " + std::to_string(edge_count) + " " + std::to_string(seed)
+			+ " " + std::to_string(trials) + " " + std::to_string(p_));
+	unsigned first_trial = 0;
+	if (checkpoint && restart_) {
+		checkpoint->load(first_trial, local_min, &engine);
+	}
+
+	for (unsigned i { first_trial }; i < trials; i++) {
 		local_min = std::min(local_min, SequentialSquareRootCut(std::make_shared<AdjacencyListGraph>(AdjacencyListGraph(g)).get(), &engine, t).compute());
+
+		if (checkpoint && (checkpoint->due() || i + 1 == trials)) {
+			checkpoint->save(i + 1, local_min, &engine);
+		}
 	}
 
 	MPI::Reduce(&local_min, &global_min, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
@@ -186,6 +245,222 @@ void SquareRootCut::runLowConcurrencyWorker() {
 }
 
 
+SquareRootCut::Result SquareRootCut::runIncrementalMaster(GraphInputIterator & input, double success_probability, uint32_t seed, double refresh_fraction) {
+	SquareRootCut::Result result;
+	result.variant = LOW_CONCURRENCY;
+
+	vertex_count_ = input.vertexCount();
+	initial_edge_count_ = input.edgeCount();
+
+	AdjacencyListGraph graph = TimeUtils::profile<AdjacencyListGraph>([&]() {
+		return AdjacencyListGraph::fromIterator(input);
+	}, "load_input");
+
+	mpi_edge_t_ = MPIDatatype<AdjacencyListGraph::Edge>::constructType();
+
+	AdjacencyListGraph::EdgeList edges = graph.edges();
+	unsigned edge_count = graph.edge_count(),
+			vertex_count = graph.vertex_count();
+	unsigned trials = (unsigned) std::ceil(double(numberOfTrials(vertex_count, edge_count, success_probability)) / processors());
+	result.trials = trials;
+
+	MPI_Barrier(communicator_);
+
+	TimeUtils::measure<void>([&]() {
+		MPI::total = 0;
+		MPI::Bcast(&edge_count, 1, MPI_UNSIGNED, 0, communicator_);
+		MPI::Bcast(&vertex_count, 1, MPI_UNSIGNED, 0, communicator_);
+		MPI::Bcast(&trials, 1, MPI_UNSIGNED, 0, communicator_);
+		MPI::Bcast(&seed, 1, MPI_UINT32_T, 0, communicator_);
+		MPI::Bcast(&refresh_fraction, 1, MPI_DOUBLE, 0, communicator_);
+		MPI::Bcast(edges.data(), edge_count, mpi_edge_t_, 0, communicator_);
+
+		incremental_.reset(new IncrementalState());
+		incremental_->graph.reset(new AdjacencyListGraph(vertex_count, std::move(edges)));
+		incremental_->engine.seed(seed + rank_);
+		incremental_->refresh_fraction = refresh_fraction;
+
+		AdjacencyListGraph::Weight local_min = runIncrementalTrials(trials);
+
+		MPI::Reduce(&local_min, &result.weight, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
+	}, result.cuttingTime);
+
+	MPI_Reduce(&MPI::total, &result.mpiTime, 1, MPI_DOUBLE, MPI_MAX, 0, communicator_);
+
+	return result;
+}
+
+void SquareRootCut::runIncrementalWorker() {
+	MPI_Barrier(communicator_);
+
+	MPI::total = 0;
+
+	mpi_edge_t_ = MPIDatatype<AdjacencyListGraph::Edge>::constructType();
+
+	AdjacencyListGraph::EdgeList edges;
+	unsigned edge_count, vertex_count, trials;
+	uint32_t seed;
+	double refresh_fraction;
+
+	MPI::Bcast(&edge_count, 1, MPI_UNSIGNED, 0, communicator_);
+	MPI::Bcast(&vertex_count, 1, MPI_UNSIGNED, 0, communicator_);
+	MPI::Bcast(&trials, 1, MPI_UNSIGNED, 0, communicator_);
+	MPI::Bcast(&seed, 1, MPI_UINT32_T, 0, communicator_);
+	MPI::Bcast(&refresh_fraction, 1, MPI_DOUBLE, 0, communicator_);
+
+	edges.resize(edge_count);
+	MPI::Bcast(edges.data(), edge_count, mpi_edge_t_, 0, communicator_);
+
+	vertex_count_ = vertex_count;
+	initial_edge_count_ = edge_count;
+
+	incremental_.reset(new IncrementalState());
+	incremental_->graph.reset(new AdjacencyListGraph(vertex_count, std::move(edges)));
+	incremental_->engine.seed(seed + rank_);
+	incremental_->refresh_fraction = refresh_fraction;
+
+	AdjacencyListGraph::Weight local_min = runIncrementalTrials(trials), global_min;
+
+	MPI::Reduce(&local_min, &global_min, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
+	MPI_Reduce(&MPI::total, NULL, 1, MPI_DOUBLE, MPI_MAX, 0, communicator_);
+}
+
+SquareRootCut::Result SquareRootCut::insertEdges(AdjacencyListGraph::EdgeList const & edges) {
+	if (!incremental_) {
+		throw std::logic_error("insertEdges requires a previous incremental run");
+	}
+
+	SquareRootCut::Result result;
+	result.variant = LOW_CONCURRENCY;
+	result.trials = (unsigned) incremental_->trials.size();
+
+	MPI_Barrier(communicator_);
+
+	TimeUtils::measure<void>([&]() {
+		MPI::total = 0;
+
+		AdjacencyListGraph::EdgeList inserted(edges);
+		unsigned count = (unsigned) inserted.size();
+		MPI::Bcast(&count, 1, MPI_UNSIGNED, 0, communicator_);
+		inserted.resize(count);
+		MPI::Bcast(inserted.data(), count, mpi_edge_t_, 0, communicator_);
+
+		AdjacencyListGraph::Weight local_min = applyInsertion(inserted);
+
+		MPI::Reduce(&local_min, &result.weight, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
+	}, result.cuttingTime);
+
+	MPI_Reduce(&MPI::total, &result.mpiTime, 1, MPI_DOUBLE, MPI_MAX, 0, communicator_);
+
+	return result;
+}
+
+SquareRootCut::Result SquareRootCut::seqIncrementalMaster(GraphInputIterator & input, double success_probability, uint32_t seed, double refresh_fraction) {
+	SquareRootCut::Result result;
+	result.variant = LOW_CONCURRENCY;
+	result.mpiTime = 0;
+
+	vertex_count_ = input.vertexCount();
+	initial_edge_count_ = input.edgeCount();
+
+	incremental_.reset(new IncrementalState());
+	incremental_->graph.reset(new AdjacencyListGraph(TimeUtils::profile<AdjacencyListGraph>([&]() {
+		return AdjacencyListGraph::fromIterator(input);
+	}, "load_input")));
+	incremental_->engine.seed(seed);
+	incremental_->refresh_fraction = refresh_fraction;
+
+	result.trials = numberOfTrials(vertex_count_, initial_edge_count_, success_probability);
+
+	result.weight = TimeUtils::measure<AdjacencyListGraph::Weight>([&]() {
+		return runIncrementalTrials(result.trials);
+	}, result.cuttingTime);
+
+	return result;
+}
+
+SquareRootCut::Result SquareRootCut::seqInsertEdges(AdjacencyListGraph::EdgeList const & edges) {
+	if (!incremental_) {
+		throw std::logic_error("seqInsertEdges requires a previous incremental run");
+	}
+
+	SquareRootCut::Result result;
+	result.variant = LOW_CONCURRENCY;
+	result.mpiTime = 0;
+	result.trials = (unsigned) incremental_->trials.size();
+
+	result.weight = TimeUtils::measure<AdjacencyListGraph::Weight>([&]() {
+		return applyInsertion(edges);
+	}, result.cuttingTime);
+
+	return result;
+}
+
+AdjacencyListGraph::Weight SquareRootCut::runIncrementalTrials(unsigned trials) {
+	IncrementalState & state = *incremental_;
+	AdjacencyListGraph & graph = *state.graph;
+
+	state.refreshed_weight = 0;
+	for (auto const & edge : graph.edges()) {
+		state.refreshed_weight += edge.weight;
+	}
+	state.inserted_weight = 0;
+
+	unsigned t = intermediate_size(graph.vertex_count(), graph.edge_count());
+	AdjacencyListGraph::Weight local_min = std::numeric_limits<AdjacencyListGraph::Weight>::max();
+
+	state.trials.clear();
+	state.trials.resize(trials);
+	for (auto & trial : state.trials) {
+		AdjacencyListGraph copy(graph);
+		local_min = std::min(local_min, SequentialSquareRootCut(&copy, &state.engine, t).compute(trial));
+	}
+
+	return local_min;
+}
+
+AdjacencyListGraph::Weight SquareRootCut::applyInsertion(AdjacencyListGraph::EdgeList const & edges) {
+	IncrementalState & state = *incremental_;
+
+	unsigned vertex_count = state.graph->vertex_count();
+	for (auto const & edge : edges) {
+		vertex_count = std::max(vertex_count, std::max(edge.from, edge.to) + 1);
+		state.inserted_weight += edge.weight;
+	}
+
+	bool new_vertex = vertex_count > state.graph->vertex_count();
+	if (new_vertex) {
+		state.graph.reset(new AdjacencyListGraph(vertex_count, state.graph->edges()));
+	}
+	for (auto const & edge : edges) {
+		state.graph->addEdge(edge);
+	}
+	// Merge the weight increases into the existing edges
+	state.graph->finalizeContractionPhase(&state.engine);
+
+	vertex_count_ = state.graph->vertex_count();
+	initial_edge_count_ = state.graph->edge_count();
+
+	if (new_vertex || state.inserted_weight > state.refresh_fraction * state.refreshed_weight) {
+		return runIncrementalTrials((unsigned) state.trials.size());
+	}
+
+	unsigned t = intermediate_size(state.graph->vertex_count(), state.graph->edge_count());
+	AdjacencyListGraph::Weight local_min = std::numeric_limits<AdjacencyListGraph::Weight>::max();
+
+	for (auto & trial : state.trials) {
+		if (!SequentialSquareRootCut::update(trial, edges, &state.engine)) {
+			// The contraction does not know some endpoint, redo the trial
+			AdjacencyListGraph copy(*state.graph);
+			SequentialSquareRootCut(&copy, &state.engine, t).compute(trial);
+		}
+		local_min = std::min(local_min, trial.weight);
+	}
+
+	return local_min;
+}
+
+
 SquareRootCut::Result SquareRootCut::participateInGroup(SamplerFactory & samplerFactory, double success_probability, uint32_t seed) {
 	SquareRootCut::Result result;
 	result.variant = HIGH_CONCURRENCY;
@@ -205,25 +480,57 @@ SquareRootCut::Result SquareRootCut::participateInGroup(SamplerFactory & sampler
 	int processors_per_trial = processors() / numberOfTrials(samplerFactory.vertex_count_, samplerFactory.edge_count_, success_probability);
 	/** Take the closest lesser than or equal power of two -- the RC impl requires it */
 	// TODO tweak the trials computation to lessen the impact
-	int group_size = (int) std::pow(
+	int group_size = group_size_override_ > 0 ? (int) group_size_override_ : (int) std::pow(
 			2,
 			std::floor(std::log2(processors_per_trial))
 	);
 	assert(group_size >= group_size_);
+	assert(group_size <= p_);
 
 	int group_count = processors() / group_size;
 
-	MPI_Comm group_communicator, equivalent_ranks_comm;
+	/**
+	 * With PACK, groups are formed from consecutive ranks in the node-major order so that the
+	 * RC transposes and reassignments stay within as few nodes as possible. The slice broadcast
+	 * then has to cross the nodes, but it happens only once.
+	 */
+	int position = placement_ == PACK ? nodeMajorPosition() : rank_;
 
 	// There may be up to group_size - 1 odd nodes -- move them to a special group and exclude them from future processing
-	if (rank_ >= group_size * group_count) {
-		MPI_Comm_split(communicator_, odd_color_, 0, &group_communicator);
-		MPI_Comm_split(communicator_, odd_color_, 0, &equivalent_ranks_comm);
+	bool odd = position >= group_size * group_count;
+	int group_color = placement_ == PACK ? position / group_size : position % group_count;
+
+	// The communicators only depend on the group size, so they are split once and reused by the following runs
+	if (groups_.group_size != group_size) {
+		freeGroupCommunicators();
+		groups_.group_size = group_size;
+
+		if (odd) {
+			MPI_Comm_split(communicator_, odd_color_, 0, &groups_.group);
+			MPI_Comm_split(communicator_, odd_color_, 0, &groups_.equivalent_ranks);
+		} else {
+			MPI_Comm_split(communicator_, group_color, position, &groups_.group);
+			int group_rank; // Our rank within group
+			MPI_Comm_rank(groups_.group, &group_rank);
+			// Create communicator for slice broadcast. Group 0 loads the input, so it has to be the root
+			MPI_Comm_split(communicator_, group_rank, group_color, &groups_.equivalent_ranks);
+			groups_.tree.reset(new comm_tree(groups_.group));
+		}
+	}
+
+	MPI_Comm group_communicator = groups_.group, equivalent_ranks_comm = groups_.equivalent_ranks;
+
+	if (odd) {
+		if (!checkpoint_directory_.empty()) {
+			// Match the restore agreement, odd nodes have nothing to restore
+			int restored = 1, all_restored;
+			MPI_Allreduce(&restored, &all_restored, 1, MPI_INT, MPI_LAND, communicator_);
+		}
 		MPI_Barrier(communicator_);
 		unsigned long dummy_local_value = std::numeric_limits<AdjacencyListGraph::Weight>::max(),
 					  dummy_global_value;
 		// Match the global reduction that happens in grouped nodes
-		MPI_Reduce(&dummy_local_value, &dummy_global_value, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+		MPI_Reduce(&dummy_local_value, &dummy_global_value, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
 		MPI_Reduce(&MPI::total, NULL, 1, MPI_DOUBLE, MPI_MAX, 0, communicator_);
 		return {};
 	}
@@ -233,19 +540,30 @@ SquareRootCut::Result SquareRootCut::participateInGroup(SamplerFactory & sampler
 	int32_t seed1 = random.operator()();
 	int32_t seed2 = random.operator()();
 
-	int group_color = rank_ % group_count;
-	MPI_Comm_split(communicator_, group_color, 0, &group_communicator);
-	int group_rank; // Our rank within group
-	MPI_Comm_rank(group_communicator, &group_rank);
-	// Create communicator for slice broadcast
-	MPI_Comm_split(communicator_, group_rank, 0, &equivalent_ranks_comm);
-
 	unsigned t = intermediate_size(samplerFactory.vertex_count_, samplerFactory.edge_count_);
 
 	std::unique_ptr<WeightedIteratedSparseSampling> sampler = samplerFactory.build(group_communicator, group_color, group_size, seed1, t);
 
+	/**
+	 * A group's trial can only be skipped together with all the others, as the slice broadcast involves every group.
+	 * Restore only if every rank has the result of its group.
+	 */
+	std::unique_ptr<TrialCheckpoint> checkpoint = openCheckpoint(
+			"high " + std::to_string(samplerFactory.vertex_count_) + " " + std::to_string(samplerFactory.edge_count_)
+			+ " " + std::to_string(seed) + " " + std::to_string(p_) + " " + std::to_string(group_size)
+			+ " " + std::to_string(placement_) + " " + std::to_string(base_case_multiplier_));
+	AdjacencyListGraph::Weight restored_result;
+	bool restored = false;
+	if (checkpoint) {
+		unsigned completed = 0;
+		int local_restored = restart_ && checkpoint->load(completed, restored_result, nullptr) && completed == 1,
+			all_restored;
+		MPI_Allreduce(&local_restored, &all_restored, 1, MPI_INT, MPI_LAND, communicator_);
+		restored = all_restored;
+	}
+
 	TimeUtils::profileStep([&]() {
-		if (group_color == 0) {
+		if (group_color == 0 && !restored) {
 			sampler->loadSlice();
 		}
 	}, rank_, "load_slice");
@@ -253,37 +571,46 @@ SquareRootCut::Result SquareRootCut::participateInGroup(SamplerFactory & sampler
 	MPI_Barrier(communicator_);
 	PAPI_START();
 
-	if (group_color == 0) {
-		sampler->broadcastSlice(equivalent_ranks_comm);
-	} else {
-		sampler->receiveSlice(equivalent_ranks_comm);
+	if (!restored) {
+		if (group_color == 0) {
+			sampler->broadcastSlice(equivalent_ranks_comm);
+		} else {
+			sampler->receiveSlice(equivalent_ranks_comm);
+		}
 	}
 
 	TimeUtils::measure<void>([&]() {
 		MPI::total = 0;
+
+		if (restored) {
+			MPI::Reduce(&restored_result, &result.weight, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
+			return;
+		}
+
 		TimeUtils::profileStep([&]() {
 			sampler->shrink();
 		}, rank_, "sampler.shrink");
 
-		GraphSlice graph_slice = TimeUtils::profileStep<GraphSlice>([&]() {
-			return sampler->reduce();
-		}, rank_, "sampler.reduce");
-
+		/*
+		 * Every row sum of the matrix and the total weight of the slices are at most twice the total weight, so
+		 * the narrow slices are safe if that fits into an int. This halves the matrix and every transfer of RC.
+		 */
+		std::vector<AdjacencyListGraph::Weight> weights;
+		AdjacencyListGraph::Weight total_weight = sampler->countEdges(weights);
+
+		unsigned long trial_result;
+		if (total_weight <= AdjacencyListGraph::Weight(std::numeric_limits<int>::max() / 2)) {
+			trial_result = groupCut<int>(*sampler, *groups_.tree, seed2);
+		} else {
+			trial_result = groupCut<long>(*sampler, *groups_.tree, seed2);
+		}
 
-		// FIXME: The thing with longs is very unfortunate. not how templates should be used
-		// Whoever did https://github.com/glukas/parallel-minimum-cut/blob/master/src/recursive_contract.hpp#L16
-		// shouldn't be allowed to touch templates ever again.
-		unsigned long trial_result = TimeUtils::profileStep<unsigned long>([&]() {
-			return (unsigned long) mincut::parallel_cut(
-					group_communicator,
-					graph_slice,
-					2,
-					seed2
-			);
-		}, rank_, "RC");
+		if (checkpoint) {
+			checkpoint->save(1, trial_result, nullptr);
+		}
 
-		// Hack: reduce across the world. Odd nodes supply max value
-		MPI::Reduce(&trial_result, &result.weight, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+		// Reduce across all groups. Odd nodes supply max value
+		MPI::Reduce(&trial_result, &result.weight, 1, MPI_UNSIGNED_LONG, MPI_MIN, 0, communicator_);
 	}, result.cuttingTime);
 
 
@@ -293,10 +620,67 @@ SquareRootCut::Result SquareRootCut::participateInGroup(SamplerFactory & sampler
 
 	PAPI_STOP(rank_, MPI::total);
 
+	sampler.reset();
+
 	// Only the master process returns a valid result
 	return result;
 }
 
+template <typename Weight>
+unsigned long SquareRootCut::groupCut(WeightedIteratedSparseSampling & sampler, const comm_tree & tree, int32_t seed) {
+	unsigned long trial_result;
+
+	// Sparse graphs stay in CSR until the contraction makes them dense
+	if (sampler.density() < mincut::dense_switch_density) {
+		sparse_graph_slice<Weight> slice = TimeUtils::profileStep<sparse_graph_slice<Weight>>([&]() {
+			return sampler.reduceSparse<Weight>();
+		}, rank_, "sampler.reduce");
+
+		trial_result = TimeUtils::profileStep<unsigned long>([&]() {
+			return (unsigned long) mincut::parallel_cut(
+					tree,
+					slice,
+					2,
+					seed
+			);
+		}, rank_, "RC");
+	} else {
+		graph_slice<Weight> slice = TimeUtils::profileStep<graph_slice<Weight>>([&]() {
+			return sampler.reduce<Weight>();
+		}, rank_, "sampler.reduce");
+
+		trial_result = TimeUtils::profileStep<unsigned long>([&]() {
+			return (unsigned long) mincut::parallel_cut(
+					tree,
+					slice,
+					2,
+					seed
+			);
+		}, rank_, "RC");
+	}
+
+	return trial_result;
+}
+
+void SquareRootCut::freeGroupCommunicators() {
+	groups_.tree.reset();
+	if (groups_.group != MPI_COMM_NULL) {
+		MPI_Comm_free(&groups_.group);
+	}
+	if (groups_.equivalent_ranks != MPI_COMM_NULL) {
+		MPI_Comm_free(&groups_.equivalent_ranks);
+	}
+	groups_.group_size = 0;
+}
+
+SquareRootCut::~SquareRootCut() {
+	int finalized;
+	MPI_Finalized(&finalized);
+	if (!finalized) {
+		freeGroupCommunicators();
+	}
+}
+
 SquareRootCut::Result SquareRootCut::runConcurrentMaster(SamplerFactory & samplerFactory, double success_probability, uint32_t seed) {
 	return participateInGroup(samplerFactory, success_probability, seed);
 }
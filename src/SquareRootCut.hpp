@@ -8,28 +8,78 @@
 #include "WeightedIteratedSparseSampling.hpp"
 #include "FileIteratedSampling.hpp"
 #include "CLICKIteratedSampling.hpp"
+#include "TrialCheckpoint.hpp"
+#include "recursive-contract/comm_tree.hpp"
 
 /**
  * Implements the sqrt(n) `sparse' minimum cut algorithm. This is the top level class
  * that abstracts away the algorithm implementation as well as MPI details.
  */
 class SquareRootCut {
+public:
+	/**
+	 * How HC groups are laid out over the physical nodes.
+	 *  - PACK places the members of a group on as few nodes as possible, keeping the RC traffic node-local
+	 *  - SPREAD assigns ranks to groups round-robin, keeping the initial slice broadcast node-local
+	 */
+	enum GroupPlacement { PACK, SPREAD };
+
+	enum Variant { LOW_CONCURRENCY, HIGH_CONCURRENCY };
+
+private:
 	MPI_Comm communicator_;
 	int p_, rank_;
 	MPI_Datatype mpi_edge_t_;
 	double base_case_multiplier_;
+	GroupPlacement placement_;
+	bool variant_overridden_ = false;
+	Variant variant_override_;
+	unsigned group_size_override_ = 0;
 	static const int odd_color_ = std::numeric_limits<int>::max();
 	void initializeDatatype();
-	typedef graph_slice<long> GraphSlice;
 	unsigned vertex_count_, initial_edge_count_;
 
+	/**
+	 * The graph and the local trials kept by the incremental interface
+	 */
+	struct IncrementalState {
+		std::unique_ptr<AdjacencyListGraph> graph;
+		std::vector<SequentialSquareRootCut::TrialState> trials;
+		sitmo::prng_engine engine;
+		double refresh_fraction;
+		/** Total weight at the last full run and weight inserted since */
+		AdjacencyListGraph::Weight refreshed_weight, inserted_weight;
+	};
+	std::unique_ptr<IncrementalState> incremental_;
+
+	std::string checkpoint_directory_;
+	bool restart_ = false;
+	double checkpoint_interval_ = 60;
+
+	/**
+	 * The HC group communicators of the last run, reused by the following runs with the same group size.
+	 * The RC communicator tree takes O(log p) collective splits to build, so it is built once per group rather
+	 * than for every cut.
+	 */
+	struct GroupCommunicators {
+		int group_size = 0;
+		MPI_Comm group = MPI_COMM_NULL, equivalent_ranks = MPI_COMM_NULL;
+		/** Only for the ranks in a group, the odd ones have none */
+		std::unique_ptr<comm_tree> tree;
+	};
+	GroupCommunicators groups_;
+
+	/**
+	 * Collective over the communicator
+	 */
+	void freeGroupCommunicators();
+
 public:
 	/**
 	 * HC minimum group size. A power of 2
 	 */
 	static const unsigned group_size_ = 2;
 
-	enum Variant { LOW_CONCURRENCY, HIGH_CONCURRENCY };
 	struct Result {
 		AdjacencyListGraph::Weight weight;
 		Variant variant;
@@ -41,9 +91,10 @@ public:
 	 * The communicator ownership is exclusive to SquareRootCut until all members have performed
 	 * a runMaster/runWorker.
 	 */
-	SquareRootCut(MPI_Comm comm, double base_case_multiplier = 2) :
+	SquareRootCut(MPI_Comm comm, double base_case_multiplier = 2, GroupPlacement placement = PACK) :
 			communicator_(comm),
-			base_case_multiplier_(base_case_multiplier)
+			base_case_multiplier_(base_case_multiplier),
+			placement_(placement)
 	{
 		MPI_Comm_size(communicator_, &p_);
 		MPI_Comm_rank(communicator_, &rank_);
@@ -57,9 +108,15 @@ public:
 	 * @param base_case_multiplier
 	 */
 	SquareRootCut(double base_case_multiplier = 2) :
-			base_case_multiplier_(base_case_multiplier)
+			base_case_multiplier_(base_case_multiplier),
+			placement_(SPREAD)
 	{}
 
+	/**
+	 * Frees the cached group communicators, unless MPI has been finalized already
+	 */
+	~SquareRootCut();
+
 	bool master() const {
 		return rank_ == 0;
 	}
@@ -76,6 +133,43 @@ public:
 		return initial_edge_count_;
 	}
 
+	double baseCaseMultiplier() const {
+		return base_case_multiplier_;
+	}
+
+	/**
+	 * Lets a cutter (and its cached group communicators) be reused for runs with different plans.
+	 * Has to be called identically on all ranks.
+	 */
+	void setBaseCaseMultiplier(double base_case_multiplier) {
+		base_case_multiplier_ = base_case_multiplier;
+	}
+
+	/**
+	 * Overrides the variant and HC group size that would otherwise be derived from the number of trials,
+	 * e.g. with the choice of an ExecutionPlanner. Has to be called identically on all ranks.
+	 *
+	 * \param variant
+	 * \param group_size HC group size, a power of 2 such that group_size * trials <= p. 0 keeps the default
+	 */
+	void overridePlan(Variant variant, unsigned group_size = 0) {
+		variant_overridden_ = true;
+		variant_override_ = variant;
+		group_size_override_ = group_size;
+	}
+
+	/**
+	 * Periodically record the completed trials in `directory`, one file per rank. Has to be called identically on all ranks.
+	 *
+	 * \param restart  Resume from the checkpoints of a previous run with the same input, seed and processor count
+	 * \param interval Seconds between two checkpoints of the LC trial loop. HC checkpoints the trial of each group once it is done
+	 */
+	void enableCheckpointing(std::string directory, bool restart, double interval = 60) {
+		checkpoint_directory_ = directory;
+		restart_ = restart;
+		checkpoint_interval_ = interval;
+	}
+
 	/**
 	 * \return Are the groups singular?
 	 */
@@ -96,8 +190,43 @@ public:
 	 */
 	unsigned numberOfTrials(unsigned n, unsigned m, double success_probability) const;
 
+	/**
+	 * \return Number of vertices the sparse sampling shrinks the graph to
+	 */
+	unsigned intermediate_size(unsigned n, unsigned m) const;
+
 	Result seqMaster(GraphInputIterator & input, double success_probability, uint32_t seed);
 
+	/**
+	 * Incremental interface. The trials are distributed as in the LC variant regardless of the processor count
+	 * (HC trials cannot be kept), and every rank keeps the contracted graphs of its trials. A subsequent
+	 * insertEdges() redoes only the base cases of the trials in which a new edge connects two contracted
+	 * vertices. All trials are run from scratch when a new vertex appears or when the weight inserted since
+	 * the last full run exceeds `refresh_fraction` of the total, as the kept contractions then no longer follow
+	 * the sampling distribution of the graph.
+	 *
+	 * \param refresh_fraction
+	 */
+	Result runIncrementalMaster(GraphInputIterator & input, double success_probability, uint32_t seed, double refresh_fraction = 0.1);
+
+	void runIncrementalWorker();
+
+	/**
+	 * Collective. Inserts edges (or increases weights, as parallel edges are merged) into the graph of the last
+	 * runIncrementalMaster/runIncrementalWorker.
+	 *
+	 * \param edges Only the master's edges are used
+	 * \return Only the master receives a valid result
+	 */
+	Result insertEdges(AdjacencyListGraph::EdgeList const & edges);
+
+	/**
+	 * Sequential version of runIncrementalMaster/insertEdges
+	 */
+	Result seqIncrementalMaster(GraphInputIterator & input, double success_probability, uint32_t seed, double refresh_fraction = 0.1);
+
+	Result seqInsertEdges(AdjacencyListGraph::EdgeList const & edges);
+
 protected:
 
 	/**
@@ -105,7 +234,18 @@ protected:
 	 */
 	double cPrime(double success_probability) const;
 
-	unsigned intermediate_size(unsigned n, unsigned m) const;
+	/**
+	 * Collective. Orders the ranks by the node they reside on (nodes are identified by MPI_COMM_TYPE_SHARED),
+	 * breaking ties by rank.
+	 *
+	 * \return Position of this rank in the node-major order
+	 */
+	int nodeMajorPosition() const;
+
+	/**
+	 * \return The checkpoint of this rank, or null if checkpointing is disabled
+	 */
+	std::unique_ptr<TrialCheckpoint> openCheckpoint(std::string fingerprint) const;
 
 	/**
 	 * \param graph
@@ -117,6 +257,18 @@ protected:
 
 	void runLowConcurrencyWorker();
 
+	/**
+	 * Run `trials` local trials from scratch on the incremental graph, keeping their state
+	 * \return The minimum over the trials
+	 */
+	AdjacencyListGraph::Weight runIncrementalTrials(unsigned trials);
+
+	/**
+	 * Add the edges to the incremental graph and update the affected trials
+	 * \return The minimum over the trials
+	 */
+	AdjacencyListGraph::Weight applyInsertion(AdjacencyListGraph::EdgeList const & edges);
+
 	/**
 	 * Wrapper to parametrize runners
 	 */
@@ -157,6 +309,15 @@ protected:
 	 */
 	Result participateInGroup(SamplerFactory & sampler, double success_probability, uint32_t seed);
 
+	/**
+	 * Builds the group's matrix with `Weight` entries and runs the RC trials on it. Sparse graphs are kept in CSR
+	 * slices until the contraction makes them dense.
+	 *
+	 * \return The smallest cut at the group root
+	 */
+	template <typename Weight>
+	unsigned long groupCut(WeightedIteratedSparseSampling & sampler, const comm_tree & tree, int32_t seed);
+
 	Result runConcurrentMaster(SamplerFactory & sampler, double success_probability, uint32_t seed);
 
 	void runConcurrentWorker(SamplerFactory & sampler, double success_probability, uint32_t seed);
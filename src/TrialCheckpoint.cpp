@@ -0,0 +1,66 @@
+#include "TrialCheckpoint.hpp"
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/stat.h>
+
+TrialCheckpoint::TrialCheckpoint(std::string directory, int rank, std::string fingerprint, double interval) :
+		path_(directory + "/rank_" + std::to_string(rank) + ".ckpt"),
+		fingerprint_(fingerprint),
+		interval_(interval),
+		last_save_(std::chrono::steady_clock::now())
+{
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		throw std::runtime_error("Cannot create checkpoint directory " + directory);
+	}
+}
+
+bool TrialCheckpoint::load(unsigned & completed, AdjacencyListGraph::Weight & minimum, sitmo::prng_engine * random) const {
+	std::ifstream file(path_);
+	std::string fingerprint;
+
+	if (!std::getline(file, fingerprint) || fingerprint != fingerprint_) {
+		return false;
+	}
+
+	unsigned stored_completed;
+	AdjacencyListGraph::Weight stored_minimum;
+	sitmo::prng_engine stored_random;
+	if (!(file >> stored_completed >> stored_minimum >> stored_random)) {
+		return false;
+	}
+
+	completed = stored_completed;
+	minimum = stored_minimum;
+	if (random != nullptr) {
+		*random = stored_random;
+	}
+
+	return true;
+}
+
+void TrialCheckpoint::save(unsigned completed, AdjacencyListGraph::Weight minimum, const sitmo::prng_engine * random) {
+	std::string temporary = path_ + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::trunc);
+		file << fingerprint_ << "\n"
+			 << completed << " " << minimum << "\n"
+			 << (random != nullptr ? *random : sitmo::prng_engine()) << "\n";
+		file.flush();
+		if (!file) {
+			throw std::runtime_error("Cannot write checkpoint " + temporary);
+		}
+	}
+
+	if (std::rename(temporary.c_str(), path_.c_str()) != 0) {
+		throw std::runtime_error("Cannot replace checkpoint " + path_);
+	}
+
+	last_save_ = std::chrono::steady_clock::now();
+}
+
+bool TrialCheckpoint::due() const {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - last_save_;
+	return elapsed.count() >= interval_;
+}
@@ -0,0 +1,49 @@
+#ifndef PARALLEL_MINIMUM_CUT_TRIALCHECKPOINT_HPP
+#define PARALLEL_MINIMUM_CUT_TRIALCHECKPOINT_HPP
+
+#include <string>
+#include <chrono>
+#include "AdjacencyListGraph.hpp"
+#include "prng_engine.hpp"
+
+/**
+ * Per-rank record of the trial progress: the number of completed trials, their minimum and the position
+ * of the rank's PRNG stream. Stored as `DIRECTORY/rank_RANK.ckpt`.
+ *
+ * The fingerprint identifies the run (input size, seed, trial distribution). Checkpoints with a different
+ * fingerprint are ignored, so a stale directory never leaks results into an unrelated run.
+ */
+class TrialCheckpoint {
+	std::string path_;
+	std::string fingerprint_;
+	double interval_;
+	std::chrono::steady_clock::time_point last_save_;
+
+public:
+	/**
+	 * \param directory Created if it does not exist
+	 * \param interval  Minimum number of seconds between two saves, see due()
+	 */
+	TrialCheckpoint(std::string directory, int rank, std::string fingerprint, double interval);
+
+	/**
+	 * \param [out] completed Number of completed trials
+	 * \param [out] minimum   Minimum over the completed trials
+	 * \param [out] random    Restored PRNG, if not null
+	 * \return Whether a checkpoint of this run exists. The outputs are not touched otherwise
+	 */
+	bool load(unsigned & completed, AdjacencyListGraph::Weight & minimum, sitmo::prng_engine * random) const;
+
+	/**
+	 * Replaces the checkpoint atomically (write and rename), so that a crash while saving leaves the previous one intact
+	 */
+	void save(unsigned completed, AdjacencyListGraph::Weight minimum, const sitmo::prng_engine * random);
+
+	/**
+	 * \return Whether the interval has elapsed since the last save
+	 */
+	bool due() const;
+};
+
+
+#endif //PARALLEL_MINIMUM_CUT_TRIALCHECKPOINT_HPP
@@ -21,14 +21,14 @@ void UnweightedIteratedSparseSampling::loadSlice(GraphInputIterator & input) {
 }
 
 
-std::vector<UnweightedGraph::Edge> UnweightedIteratedSparseSampling::sample(unsigned edge_count) {
+std::vector<UnweightedGraph::Edge> UnweightedIteratedSparseSampling::sample(size_t edge_count) {
 	std::vector<UnweightedGraph::Edge> edges;
 	size_t size = edges_slice_.size();
 
 	if (edge_count == edges_slice_.size()) {
 		return edges_slice_;
 	} else {
-		for (unsigned i = 0; i < edge_count; i++) {
+		for (size_t i = 0; i < edge_count; i++) {
 			edges.push_back(edges_slice_.at(random_engine_() % size));
 		}
 	}
@@ -71,22 +71,22 @@ unsigned UnweightedIteratedSparseSampling::connectedComponents(std::vector<unsig
 	return vertex_count_;
 }
 
-unsigned UnweightedIteratedSparseSampling::countEdges() {
-	unsigned local_edges = edges_slice_.size(), edges;
-	MPI::Allreduce(&local_edges, &edges, 1, MPI_UNSIGNED, MPI_SUM, communicator_);
+size_t UnweightedIteratedSparseSampling::countEdges() {
+	size_t local_edges = edges_slice_.size(), edges;
+	MPI::Allreduce(&local_edges, &edges, 1, MPI_SIZE_T, MPI_SUM, communicator_);
 	return edges;
 }
 
-std::vector<int> UnweightedIteratedSparseSampling::edgesToSamplePerProcessor(std::vector<int> edges_available_per_processor) {
-	unsigned total_edges = (unsigned) std::accumulate(edges_available_per_processor.begin(), edges_available_per_processor.end(), 0);
-	unsigned number_of_edges_to_sample = std::min(
-			unsigned(std::pow((float) initial_vertex_count_, 1 + epsilon_ / 2) * (1 + delta_)),
+std::vector<size_t> UnweightedIteratedSparseSampling::edgesToSamplePerProcessor(std::vector<size_t> edges_available_per_processor) {
+	size_t total_edges = std::accumulate(edges_available_per_processor.begin(), edges_available_per_processor.end(), size_t(0));
+	size_t number_of_edges_to_sample = std::min(
+			size_t(std::pow((double) initial_vertex_count_, 1 + epsilon_ / 2) * (1 + delta_)),
 			total_edges
 	);
-	unsigned sparsity_threshold = unsigned(float(3) / (delta_ * delta_) * std::log(group_size_ / 0.9f));
-	unsigned remaining_edges = number_of_edges_to_sample;
+	size_t sparsity_threshold = size_t(float(3) / (delta_ * delta_) * std::log(group_size_ / 0.9f));
+	size_t remaining_edges = number_of_edges_to_sample;
 
-	std::vector<int> edges_per_processor(group_size_, 0);
+	std::vector<size_t> edges_per_processor(group_size_, 0);
 
 	// First look at processors with few edges
 	for (size_t i = 0; i < group_size_; i++) {
@@ -106,7 +106,7 @@ std::vector<int> UnweightedIteratedSparseSampling::edgesToSamplePerProcessor(std
 		}
 
 		edges_per_processor.at(i) = std::min(
-				int(float(number_of_edges_to_sample) * edges_available_per_processor.at(i) / total_edges),
+				size_t(double(number_of_edges_to_sample) * edges_available_per_processor.at(i) / total_edges),
 				edges_available_per_processor.at(i)
 		);
 		remaining_edges -= edges_per_processor.at(i);
@@ -117,7 +117,7 @@ std::vector<int> UnweightedIteratedSparseSampling::edgesToSamplePerProcessor(std
 	size_t spillover = 0;
 	while (remaining_edges > 0) {
 		if (edges_available_per_processor.at(spillover) > edges_per_processor.at(spillover)) {
-			int delta = std::min(edges_available_per_processor.at(spillover) - edges_per_processor.at(spillover), (int) remaining_edges);
+			size_t delta = std::min(edges_available_per_processor.at(spillover) - edges_per_processor.at(spillover), remaining_edges);
 			edges_per_processor.at(spillover) += delta;
 			remaining_edges -= delta;
 		}
@@ -127,15 +127,15 @@ std::vector<int> UnweightedIteratedSparseSampling::edgesToSamplePerProcessor(std
 	return edges_per_processor;
 }
 
-std::vector<int> UnweightedIteratedSparseSampling::edgesAvailablePerProcessor() {
-	int available = (int) edges_slice_.size(); // MPI displacement types are rather unfortunate
-	std::vector<int> edges_per_processor;
+std::vector<size_t> UnweightedIteratedSparseSampling::edgesAvailablePerProcessor() {
+	size_t available = edges_slice_.size();
+	std::vector<size_t> edges_per_processor;
 
 	if (master()) {
 		edges_per_processor.resize(group_size_);
 	}
 
-	MPI::Gather(&available, 1, MPI_INT, edges_per_processor.data(), 1, MPI_INT, root_rank_, communicator_);
+	MPI::Gather(&available, 1, MPI_SIZE_T, edges_per_processor.data(), 1, MPI_SIZE_T, root_rank_, communicator_);
 
 	return edges_per_processor; // NRVO
 }
@@ -25,22 +25,22 @@ public:
 	void loadSlice(GraphInputIterator & input);
 
 protected:
-	unsigned countEdges();
+	size_t countEdges();
 
 	/**
 	 * @return A vector whose entries correspond to the number of edges to sample at that processor
 	 *
-	 * We use `int` because this vector will be used to compute MPI displacements
+	 * The counts are size_t and used for the large-count MPI displacements
 	 */
-	std::vector<int> edgesToSamplePerProcessor(std::vector<int> edges_available_per_processor);
+	std::vector<size_t> edgesToSamplePerProcessor(std::vector<size_t> edges_available_per_processor);
 
-	virtual std::vector<UnweightedGraph::Edge> sample(unsigned edge_count);
+	virtual std::vector<UnweightedGraph::Edge> sample(size_t edge_count);
 
 	/**
 	 * Has to be called collectively
 	 * @return Edges per rank, at root only
 	 */
-	std::vector<int> edgesAvailablePerProcessor();
+	std::vector<size_t> edgesAvailablePerProcessor();
 };
 
 
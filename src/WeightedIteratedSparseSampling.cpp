@@ -1,5 +1,7 @@
 #include <stdexcept>
+#include <unordered_map>
 #include "WeightedIteratedSparseSampling.hpp"
+#include "sorting/RadixSort.hpp"
 
 void WeightedIteratedSparseSampling::shrink() {
 	while (!samplingTrial()) {}
@@ -23,7 +25,68 @@ bool WeightedIteratedSparseSampling::samplingTrial() {
 	return vertex_count_ == target_size_;
 }
 
-graph_slice<long> WeightedIteratedSparseSampling::reduce() {
+template <typename Weight>
+graph_slice<Weight> WeightedIteratedSparseSampling::reduce() {
+	std::vector<AdjacencyListGraph::Edge> locally_reduced_slice = combineParallelEdges();
+	return distributeRows<Weight>(locally_reduced_slice);
+}
+
+template <typename Weight>
+sparse_graph_slice<Weight> WeightedIteratedSparseSampling::reduceSparse() {
+	std::vector<AdjacencyListGraph::Edge> locally_reduced_slice = combineParallelEdges();
+
+	int rows_per_processor = (int) std::ceil(double(vertex_count_) / group_size_);
+
+	// Both triangles, as in distributeRows. The loops would be dropped by the slice anyway
+	std::vector<weighted_edge_struct_t> entries;
+	entries.reserve(2 * locally_reduced_slice.size());
+	for (auto const & edge : locally_reduced_slice) {
+		if (edge.from != edge.to) {
+			entries.push_back({ int(edge.from), int(edge.to), long(edge.weight) });
+			entries.push_back({ int(edge.to), int(edge.from), long(edge.weight) });
+		}
+	}
+	std::vector<AdjacencyListGraph::Edge>().swap(locally_reduced_slice);
+
+	std::vector<weighted_edge_struct_t> incoming = send_to_row_owners(communicator_, entries, rows_per_processor);
+
+	return sparse_graph_slice<Weight>(vertex_count_, rows_per_processor, rank_, incoming);
+}
+
+double WeightedIteratedSparseSampling::density() {
+	size_t local_edges = edges_slice_.size(), edges;
+	MPI::Allreduce(&local_edges, &edges, 1, MPI_SIZE_T, MPI_SUM, communicator_);
+
+	return 2.0 * edges / (double(vertex_count_) * vertex_count_);
+}
+
+std::vector<AdjacencyListGraph::Edge> WeightedIteratedSparseSampling::combineParallelEdges() {
+	/*
+	 * Combine parallel edges locally. The remaining duplicates are spread over the group, they meet at the owner
+	 * of their rows and are summed up there
+	 */
+	std::unordered_map<uint64_t, AdjacencyListGraph::Weight> combined;
+	combined.reserve(edges_slice_.size());
+
+	for (auto edge : edges_slice_) {
+		edge.normalize();
+		combined[(uint64_t(edge.from) << 32) | edge.to] += edge.weight;
+	}
+
+	std::vector<AdjacencyListGraph::Edge> locally_reduced_slice;
+	locally_reduced_slice.reserve(2 * combined.size());
+	for (auto const & entry : combined) {
+		locally_reduced_slice.push_back({ unsigned(entry.first >> 32), unsigned(entry.first), entry.second });
+	}
+
+	// Not needed anymore
+	std::vector<AdjacencyListGraph::Edge>().swap(edges_slice_);
+
+	return locally_reduced_slice;
+}
+
+template <typename Weight>
+graph_slice<Weight> WeightedIteratedSparseSampling::reduceSorted() {
 	// To enable correct sorting
 	std::for_each(
 			edges_slice_.begin(),
@@ -31,7 +94,7 @@ graph_slice<long> WeightedIteratedSparseSampling::reduce() {
 			[](AdjacencyListGraph::Edge & e) { e.normalize(); }
 	);
 
-	SamplingSorter<AdjacencyListGraph::Edge> sorter(communicator_, std::move(edges_slice_), seed_with_offset_);
+	SamplingSorter<AdjacencyListGraph::Edge> sorter(communicator_, std::move(edges_slice_));
 	std::vector<AdjacencyListGraph::Edge> sorted_slice = sorter.sort();
 
 	// Fun part: reduce edges
@@ -126,9 +189,11 @@ graph_slice<long> WeightedIteratedSparseSampling::reduce() {
 		}
 	}
 
-	// TODO scope the locals so that we can throw away the sorted list
-
+	return distributeRows<Weight>(locally_reduced_slice);
+}
 
+template <typename Weight>
+graph_slice<Weight> WeightedIteratedSparseSampling::distributeRows(std::vector<AdjacencyListGraph::Edge> & edges) {
 	/*
 	 * Matrix construction time.
 	 *
@@ -136,62 +201,71 @@ graph_slice<long> WeightedIteratedSparseSampling::reduce() {
 	 * the matrix is distributed row-wise such that each processor holds ceil(n/p) consecutive rows of the matrix."
 	 * "note also that the matrix needs to be padded with zeroes, such that p' divides the number of rows."
 	 *
-	 * A minor problem is that it is easy to determine where to send the edges based on the first component (they
-	 * are sorted by it and thus we can compute non-uniform all-to-all displacements, but this will only initialize
-	 * one half of the entries, the corresponding symmetric entries will be missing. We just add a transpose manually.
+	 * The owner of an edge is determined by its first component, but this will only initialize one half of the
+	 * entries, the corresponding symmetric entries will be missing. We just add a transpose manually.
 	 *
-	 * TODO is there a nicer way to do it already built in?
+	 * The edges are bucketed by owner with a counting pass, no sorting needed. The owner sums up whatever arrives
+	 * for the same entry, so the edges do not have to be unique across the group.
 	 */
 
 	{
-		int rows_per_processor = (int) std::ceil(float(vertex_count_) / group_size_);
-		int row_col_size = rows_per_processor * group_size_;
+		size_t rows_per_processor = (size_t) std::ceil(double(vertex_count_) / group_size_);
+		size_t row_col_size = rows_per_processor * group_size_;
 
 		/** p_i will receive edges_per_processor[i] edges to place in its slice of rows */
-		std::vector<int> edges_per_processor(group_size_, 0);
+		std::vector<size_t> edges_per_processor(group_size_, 0);
 
-		// Duplicate edges to get both triangles
+		// Duplicate edges to get both triangles (loops are on the diagonal already)
 		{
-			size_t original_size = locally_reduced_slice.size();
+			size_t original_size = edges.size();
 			for (size_t i { 0 }; i < original_size; i++) {
-				AdjacencyListGraph::Edge e = locally_reduced_slice.at(i);
-				std::swap(e.from, e.to);
-				locally_reduced_slice.push_back(e);
+				AdjacencyListGraph::Edge e = edges.at(i);
+				if (e.from != e.to) {
+					std::swap(e.from, e.to);
+					edges.push_back(e);
+				}
 			}
 		}
 
-		std::sort(locally_reduced_slice.begin(), locally_reduced_slice.end());
-
-		for (auto const edge : locally_reduced_slice) {
+		for (auto const edge : edges) {
 			edges_per_processor.at(edge.from / rows_per_processor)++;
 		}
 
 		/** Receive displacements */
-		std::vector<int> edges_to_receive(group_size_);
+		std::vector<size_t> edges_to_receive(group_size_);
 
 		/* Exchange segment sizes */
 		MPI::Alltoall(
 				edges_per_processor.data(),
 				1,
-				MPI_INT,
+				MPI_SIZE_T,
 				edges_to_receive.data(),
 				1,
-				MPI_INT,
+				MPI_SIZE_T,
 				communicator_
 		);
 
 		/** Compute offsets */
-		std::vector<int> arriving_edges_offsets = MPIUtils::prefix_offsets(edges_to_receive);
-		std::vector<int> edges_groups_offsets = MPIUtils::prefix_offsets(edges_per_processor);
-		int number_of_edges_to_receive = std::accumulate(edges_to_receive.begin(), edges_to_receive.end(), 0);
+		std::vector<size_t> arriving_edges_offsets = MPIUtils::prefix_offsets(edges_to_receive);
+		std::vector<size_t> edges_groups_offsets = MPIUtils::prefix_offsets(edges_per_processor);
+		size_t number_of_edges_to_receive = std::accumulate(edges_to_receive.begin(), edges_to_receive.end(), size_t(0));
 		/** Target buffer */
 		std::vector<AdjacencyListGraph::Edge> incoming_edges_buffer(number_of_edges_to_receive);
 
-		MPI::Alltoallv(
-				locally_reduced_slice.data(),
+		/** Our edges grouped by owner */
+		std::vector<AdjacencyListGraph::Edge> outgoing_edges_buffer(edges.size());
+		{
+			std::vector<size_t> next(edges_groups_offsets);
+			for (auto const edge : edges) {
+				outgoing_edges_buffer[next[edge.from / rows_per_processor]++] = edge;
+			}
+			std::vector<AdjacencyListGraph::Edge>().swap(edges);
+		}
+
+		MPI::Alltoallv_large(
+				outgoing_edges_buffer.data(),
 				edges_per_processor.data(),
 				edges_groups_offsets.data(),
-				mpi_edge_t_,
 				incoming_edges_buffer.data(),
 				edges_to_receive.data(),
 				arriving_edges_offsets.data(),
@@ -200,15 +274,14 @@ graph_slice<long> WeightedIteratedSparseSampling::reduce() {
 		);
 
 		// C++ it like it's 1998
-		// FIXME longs
-		long * rows_slice = new long[row_col_size * rows_per_processor];
-		std::fill(rows_slice, rows_slice + row_col_size * rows_per_processor, 0l);
+		Weight * rows_slice = new Weight[row_col_size * rows_per_processor];
+		std::fill(rows_slice, rows_slice + row_col_size * rows_per_processor, Weight(0));
 
 		/** Global index of our first row */
 		size_t row_offset = rows_per_processor * rank_;
 
 		for (auto edge : incoming_edges_buffer) {
-			rows_slice[(edge.from - row_offset) * row_col_size + edge.to] = edge.weight;
+			rows_slice[(edge.from - row_offset) * row_col_size + edge.to] += edge.weight;
 		}
 
 		DebugUtils::print(rank_, [&](std::ostream & out) {
@@ -218,8 +291,7 @@ graph_slice<long> WeightedIteratedSparseSampling::reduce() {
 				<< " color: " << color_;
 		});
 
-		// FIXME  longs
-		graph_slice<long> graph_slice(
+		graph_slice<Weight> graph_slice(
 				vertex_count_,
 				rows_per_processor,
 				rank_,
@@ -233,7 +305,14 @@ graph_slice<long> WeightedIteratedSparseSampling::reduce() {
 	}
 }
 
-std::vector<AdjacencyListGraph::Edge> WeightedIteratedSparseSampling::sample(unsigned edge_count) {
+template graph_slice<int> WeightedIteratedSparseSampling::reduce<int>();
+template graph_slice<long> WeightedIteratedSparseSampling::reduce<long>();
+template graph_slice<int> WeightedIteratedSparseSampling::reduceSorted<int>();
+template graph_slice<long> WeightedIteratedSparseSampling::reduceSorted<long>();
+template sparse_graph_slice<int> WeightedIteratedSparseSampling::reduceSparse<int>();
+template sparse_graph_slice<long> WeightedIteratedSparseSampling::reduceSparse<long>();
+
+std::vector<AdjacencyListGraph::Edge> WeightedIteratedSparseSampling::sample(size_t edge_count) {
 	/**
 	 * Preprocessing
 	 */
@@ -263,7 +342,7 @@ std::vector<AdjacencyListGraph::Edge> WeightedIteratedSparseSampling::sample(uns
 	// TODO possibly keep the computed weight
 	std::uniform_int_distribution<AdjacencyListGraph::Weight> uniform_int(
 			1,
-			std::accumulate(edge_weights.begin(), edge_weights.end(), 0)
+			std::accumulate(edge_weights.begin(), edge_weights.end(), AdjacencyListGraph::Weight(0))
 	);
 
 	/**
@@ -283,7 +362,7 @@ void WeightedIteratedSparseSampling::gatherWeights(std::vector<AdjacencyListGrap
 	AdjacencyListGraph::Weight slice_weight = std::accumulate(
 			edges_slice_.begin(),
 			edges_slice_.end(),
-			0,
+			AdjacencyListGraph::Weight(0),
 			[](AdjacencyListGraph::Weight state, AdjacencyListGraph::Edge & edge) { return state + edge.weight; }
 	);
 
@@ -307,7 +386,7 @@ AdjacencyListGraph::Weight WeightedIteratedSparseSampling::countEdges(std::vecto
 	unsigned long edges;
 
 	if (master()) {
-		edges = std::accumulate(weights.begin(), weights.end(), 0);
+		edges = std::accumulate(weights.begin(), weights.end(), AdjacencyListGraph::Weight(0));
 	}
 	MPI::Bcast(&edges, 1, MPI_UNSIGNED_LONG, root_rank_, communicator_);
 
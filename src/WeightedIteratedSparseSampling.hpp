@@ -3,6 +3,7 @@
 
 #include "IteratedSparseSampling.hpp"
 #include "AdjacencyListGraph.hpp"
+#include "recursive-contract/sparse_graph_slice.hpp"
 
 /**
  * Provides ISS on weighted graphs, and adds the following functionality
@@ -26,18 +27,45 @@ public:
 	bool samplingTrial();
 
 	/**
-	 * Reduce results across all nodes
+	 * Reduce results across all nodes. Parallel edges are combined in a hash table, then every edge is sent
+	 * straight to the owner of its row, which sums up the duplicates from the other ranks.
+	 *
+	 * The slice stores Weight (int or long), the caller has to make sure that the total weight fits.
+	 *
+	 * @return Input for recursive contract
+	 */
+	template <typename Weight = long>
+	graph_slice<Weight> reduce();
+
+	/**
+	 * Same as `reduce`, but combines parallel edges with a distributed sample sort and a merge of the slice
+	 * boundaries.
 	 *
 	 * @return Input for recursive contract
 	 */
-	graph_slice<long> reduce();
+	template <typename Weight = long>
+	graph_slice<Weight> reduceSorted();
+
+	/**
+	 * Same as `reduce`, but builds CSR row slices, so the memory is proportional to the number of edges
+	 *
+	 * @return Input for the sparse recursive contract
+	 */
+	template <typename Weight = long>
+	sparse_graph_slice<Weight> reduceSparse();
+
+	/**
+	 * Collective. Upper bound on the fraction of nonzero entries of the adjacency matrix `reduce` would build
+	 * (parallel edges are counted separately).
+	 */
+	double density();
 
 	/**
 	 * Sample `edge_count` edges locally, prop. to their weight
 	 * @param edge_count
 	 * @return The edge sample
 	 */
-	virtual std::vector<AdjacencyListGraph::Edge> sample(unsigned edge_count);
+	virtual std::vector<AdjacencyListGraph::Edge> sample(size_t edge_count);
 
 	/**
 	 * @param weights Fills the weights array in the master (the others are left unchanged)
@@ -61,13 +89,12 @@ public:
 	/**
 	 * @return A vector whose entries correspond to the number of edges to sample at that processor
 	 *
-	 * We use `int` because this vector will be used to compute MPI displacements
+	 * The counts are size_t and used for the large-count MPI displacements
 	 */
-	std::vector<int> edgesToSamplePerProcessor(std::vector<AdjacencyListGraph::Weight> const & weights) {
-		unsigned number_of_edges_to_sample = (unsigned) std::pow((float) initial_vertex_count_, 1 + epsilon_ / 2);
+	std::vector<size_t> edgesToSamplePerProcessor(std::vector<AdjacencyListGraph::Weight> const & weights) {
+		size_t number_of_edges_to_sample = (size_t) std::pow((double) initial_vertex_count_, 1 + epsilon_ / 2);
 		// [i] = how many i should sample
-		// We use ints to allow using this for the displacements
-		std::vector<int> edges_per_processor(group_size_, 0);
+		std::vector<size_t> edges_per_processor(group_size_, 0);
 
 		sum_tree<AdjacencyListGraph::Weight> index(weights.data(), group_size_);
 		AdjacencyListGraph::Weight sum = index.root();
@@ -82,6 +109,19 @@ public:
 
 		return edges_per_processor;
 	}
+
+protected:
+	/**
+	 * Normalizes the edges of the slice and sums up the parallel ones. Consumes the slice.
+	 */
+	std::vector<AdjacencyListGraph::Edge> combineParallelEdges();
+
+	/**
+	 * Builds the dense row slices: mirrors `edges` and delivers every entry to the owner of its row, where
+	 * entries for the same position are added up. Consumes `edges`.
+	 */
+	template <typename Weight>
+	graph_slice<Weight> distributeRows(std::vector<AdjacencyListGraph::Edge> & edges);
 };
 
 
@@ -0,0 +1,321 @@
+// Computes the minimum cuts of many graphs within a single MPI job
+//
+// The manifest (a file, or `-` for stdin) lists one job per line:
+//
+//     INPUT_FILE PROBABILITY SEED
+//
+// Empty lines and lines starting with `#` are skipped. Rank 0 only dispatches: it reads the manifest incrementally
+// and sizes every job by the ExecutionPlanner as the smallest power of 2 whose predicted running time is within SLACK
+// of the best one. The other ranks are split once into aligned blocks of every power of 2, and a job starts, in
+// manifest order, on the first block of its size whose ranks are all idle. The master of the block reports to rank 0
+// when its job finishes, so the segments pick up new jobs independently of each other.
+//
+// The master of every segment prints the square_root CSV line as soon as its job finishes.
+
+#include "../SquareRootCut.hpp"
+#include "../ExecutionPlanner.hpp"
+#include "input/GraphInputIterator.hpp"
+#include "../utils.hpp"
+#include "thread_pool.hpp"
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+struct Job {
+	std::string input;
+	float success_probability;
+	uint32_t seed;
+	int size;
+	SquareRootCut::Variant variant;
+	unsigned group_size;
+	double base_case_multiplier;
+};
+
+/**
+ * \return The smallest power-of-2 number of processors whose plan is within `slack` of the fastest one
+ */
+ExecutionPlanner::Plan planSegment(const ExecutionPlanner & planner, unsigned n, unsigned m, int p, float success_probability, double slack, int & size) {
+	std::vector<std::pair<int, ExecutionPlanner::Plan>> plans;
+	double best = std::numeric_limits<double>::max();
+
+	for (int q = 1; q <= p; q *= 2) {
+		ExecutionPlanner::Plan plan = planner.plan(n, m, (unsigned) q, success_probability);
+		plans.push_back({ q, plan });
+		best = std::min(best, plan.predicted_time);
+	}
+
+	for (auto & candidate : plans) {
+		if (candidate.second.predicted_time <= slack * best) {
+			size = candidate.first;
+			return candidate.second;
+		}
+	}
+
+	size = plans.back().first;
+	return plans.back().second;
+}
+
+const int job_tag = 1, done_tag = 2;
+
+/**
+ * The communicator of one aligned block of workers and the cutter reusing its group communicators across jobs
+ */
+struct Segment {
+	MPI_Comm communicator = MPI_COMM_NULL;
+	std::unique_ptr<SquareRootCut> cutter;
+};
+
+/**
+ * Root only. Reads the next well-formed job from the manifest, reporting the skipped lines
+ *
+ * \param workers Number of ranks the segments are carved from
+ * \return false at the end of the manifest
+ */
+bool readJob(std::istream & manifest, const ExecutionPlanner & planner, int workers, double slack, Job & job) {
+	std::string line;
+	while (std::getline(manifest, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream fields(line);
+		if (!(fields >> job.input >> job.success_probability >> job.seed)) {
+			std::cout << line << ",error,malformed job" << std::endl;
+			continue;
+		}
+
+		unsigned n, m;
+		try {
+			GraphInputIterator input(job.input);
+			n = input.vertexCount();
+			m = input.edgeCount();
+		} catch (std::exception & e) {
+			std::cout << job.input << "," << job.seed << ",error,cannot read input" << std::endl;
+			continue;
+		}
+
+		ExecutionPlanner::Plan plan = planSegment(planner, n, m, workers, job.success_probability, slack, job.size);
+		job.variant = plan.variant;
+		job.group_size = plan.group_size;
+		job.base_case_multiplier = plan.base_case_multiplier;
+		return true;
+	}
+
+	return false;
+}
+
+std::string serialize(const Job & job) {
+	std::ostringstream out;
+	out.precision(17);
+	out << job.input << " "
+		<< job.success_probability << " "
+		<< job.seed << " "
+		<< job.size << " "
+		<< job.variant << " "
+		<< job.group_size << " "
+		<< job.base_case_multiplier;
+	return out.str();
+}
+
+Job deserialize(const std::string & description) {
+	Job job;
+	int variant;
+	std::istringstream in(description);
+	in >> job.input >> job.success_probability >> job.seed >> job.size >> variant >> job.group_size >> job.base_case_multiplier;
+	job.variant = (SquareRootCut::Variant) variant;
+	return job;
+}
+
+/**
+ * Collective over the cutter's communicator. The master prints the result
+ */
+void runJob(SquareRootCut & cutter, const Job & job) {
+	cutter.setBaseCaseMultiplier(job.base_case_multiplier);
+	cutter.overridePlan(job.variant, job.group_size);
+
+	GraphInputIterator input(job.input);
+	if (cutter.master()) {
+		SquareRootCut::Result res = cutter.runMaster(input, job.success_probability, job.seed);
+
+		std::cout << job.input << ","
+				  << job.seed << ","
+				  << cutter.processors() << ","
+				  << cutter.initialVertexCount() << ","
+				  << cutter.initialEdgeCount() << ","
+				  << res.cuttingTime << ","
+				  << res.mpiTime << ","
+				  << res.trials << ","
+				  << (res.variant == SquareRootCut::Variant::HIGH_CONCURRENCY ? "high" : "low") << ","
+				  << res.weight << std::endl;
+	} else {
+		cutter.runWorker(input, job.success_probability, job.seed);
+	}
+}
+
+/**
+ * \return The offset of the first aligned block of `size` idle workers, or -1 if there is none
+ */
+int findBlock(const std::vector<bool> & busy, int size) {
+	for (int offset = 0; offset + size <= (int) busy.size(); offset += size) {
+		if (std::find(busy.begin() + offset, busy.begin() + offset + size, true) == busy.begin() + offset + size) {
+			return offset;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Root only. Sends every job to all members of a block of idle workers and waits for the segment masters to report
+ * back, until the manifest is exhausted and all segments are done. Worker w is rank w + 1.
+ */
+void dispatch(std::istream & manifest, const ExecutionPlanner & planner, int workers, double slack) {
+	std::vector<bool> busy((size_t) workers, false);
+	// Segment size by the rank of its master
+	std::map<int, int> running;
+
+	Job job;
+	bool has_job = readJob(manifest, planner, workers, slack, job);
+
+	while (has_job || !running.empty()) {
+		// Jobs start in manifest order, one that does not fit yet holds back the following ones
+		int offset;
+		while (has_job && (offset = findBlock(busy, job.size)) >= 0) {
+			std::string description = serialize(job);
+			for (int w = offset; w < offset + job.size; w++) {
+				busy[w] = true;
+				MPI_Send(description.data(), (int) description.size(), MPI_CHAR, w + 1, job_tag, MPI_COMM_WORLD);
+			}
+			running[offset + 1] = job.size;
+			has_job = readJob(manifest, planner, workers, slack, job);
+		}
+
+		if (running.empty()) {
+			continue;
+		}
+
+		MPI_Status status;
+		MPI_Recv(nullptr, 0, MPI_CHAR, MPI_ANY_SOURCE, done_tag, MPI_COMM_WORLD, &status);
+		std::fill(busy.begin() + status.MPI_SOURCE - 1, busy.begin() + status.MPI_SOURCE - 1 + running.at(status.MPI_SOURCE), false);
+		running.erase(status.MPI_SOURCE);
+	}
+
+	// An empty job stops the worker
+	for (int w = 0; w < workers; w++) {
+		MPI_Send(nullptr, 0, MPI_CHAR, w + 1, job_tag, MPI_COMM_WORLD);
+	}
+}
+
+/**
+ * Runs the jobs sent by the dispatcher on the segment of their size until an empty one arrives
+ */
+void work(std::map<int, Segment> & segments, SquareRootCut::GroupPlacement placement) {
+	while (true) {
+		MPI_Status status;
+		int length;
+		MPI_Probe(0, job_tag, MPI_COMM_WORLD, &status);
+		MPI_Get_count(&status, MPI_CHAR, &length);
+
+		std::string description((size_t) length, ' ');
+		MPI_Recv(&description[0], length, MPI_CHAR, 0, job_tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		if (length == 0) {
+			break;
+		}
+
+		Job job = deserialize(description);
+		Segment & segment = segments.at(job.size);
+		if (!segment.cutter) {
+			segment.cutter.reset(new SquareRootCut(segment.communicator, job.base_case_multiplier, placement));
+		}
+
+		runJob(*segment.cutter, job);
+
+		if (segment.cutter->master()) {
+			MPI_Send(nullptr, 0, MPI_CHAR, 0, done_tag, MPI_COMM_WORLD);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::map<std::string, std::string> options = ArgUtils::extractOptions(argc, argv);
+
+	if (argc != 2) {
+		std::cout << "Usage: batch_cut [--placement=pack|spread] [--threads=N] [--slack=1.25] [--memory=GB] MANIFEST|-" << std::endl;
+		return 1;
+	}
+
+	SquareRootCut::GroupPlacement placement = SquareRootCut::PACK;
+	if (options.count("placement")) {
+		if (options.at("placement") == "spread") {
+			placement = SquareRootCut::SPREAD;
+		} else if (options.at("placement") != "pack") {
+			std::cout << "Unknown placement " << options.at("placement") << ", expected pack or spread" << std::endl;
+			return 1;
+		}
+	}
+	double slack = options.count("slack") ? std::stod(options.at("slack")) : 1.25;
+	double memory = options.count("memory") ? std::stod(options.at("memory")) * (1 << 30) : 0;
+
+	// Threads per process for the dense contraction kernels. Only the main thread calls MPI
+	int threads = options.count("threads") ? std::stoi(options.at("threads")) : 1;
+	if (threads > 1) {
+		int provided;
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+		if (provided < MPI_THREAD_FUNNELED) {
+			std::cerr << "MPI_THREAD_FUNNELED is not supported, running with one thread per process" << std::endl;
+			threads = 1;
+		}
+	} else {
+		MPI_Init(&argc, &argv);
+	}
+	thread_pool::set_global_threads(threads);
+
+	int p, rank;
+	MPI_Comm_size(MPI_COMM_WORLD, &p);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	// Calibrated once for the whole batch
+	ExecutionPlanner planner(ExecutionPlanner::calibrate(MPI_COMM_WORLD, memory));
+
+	std::ifstream manifest_file;
+	std::istream * manifest = &std::cin;
+	if (rank == 0 && std::string(argv[1]) != "-") {
+		manifest_file.open(argv[1]);
+		manifest = &manifest_file;
+	}
+
+	std::cout << std::fixed;
+
+	if (p == 1) {
+		// Nobody to dispatch to, the jobs run one after another
+		SquareRootCut cutter(MPI_COMM_WORLD, 2, placement);
+		Job job;
+		while (readJob(*manifest, planner, 1, slack, job)) {
+			runJob(cutter, job);
+		}
+	} else {
+		// Splitting the workers into aligned blocks of every power of 2 up front fixes the segment of every worker for
+		// every size, so segments are never split again and their cutters are kept for the whole batch
+		int workers = p - 1;
+		std::map<int, Segment> segments;
+		for (int size = 1; size <= workers; size *= 2) {
+			MPI_Comm_split(MPI_COMM_WORLD, rank == 0 ? MPI_UNDEFINED : (rank - 1) / size, rank, &segments[size].communicator);
+		}
+
+		if (rank == 0) {
+			dispatch(*manifest, planner, workers, slack);
+		} else {
+			work(segments, placement);
+		}
+
+		for (auto & segment : segments) {
+			// The cutter frees its group communicators first
+			segment.second.cutter.reset();
+			if (segment.second.communicator != MPI_COMM_NULL) {
+				MPI_Comm_free(&segment.second.communicator);
+			}
+		}
+	}
+
+	MPI_Finalize();
+}
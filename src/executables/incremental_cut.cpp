@@ -0,0 +1,85 @@
+// Computes the minimum cut of a graph and updates it after batches of edge insertions
+//
+// The updates file lists `FROM TO WEIGHT` edges, one per line. Batches are separated by empty lines.
+// One CSV line is printed for the initial run (batch 0) and for every batch.
+
+#include "../SquareRootCut.hpp"
+#include "input/GraphInputIterator.hpp"
+#include "../utils.hpp"
+#include <fstream>
+#include <sstream>
+
+std::vector<AdjacencyListGraph::EdgeList> readBatches(std::string name) {
+	std::vector<AdjacencyListGraph::EdgeList> batches(1);
+	std::ifstream file(name);
+	std::string line;
+
+	while (std::getline(file, line)) {
+		if (line.empty()) {
+			if (!batches.back().empty()) {
+				batches.emplace_back();
+			}
+			continue;
+		}
+
+		unsigned from, to;
+		AdjacencyListGraph::Weight weight;
+		std::istringstream(line) >> from >> to >> weight;
+		batches.back().push_back({ from, to, weight });
+	}
+
+	if (batches.back().empty()) {
+		batches.pop_back();
+	}
+
+	return batches;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 5) {
+		std::cout << "Usage: incremental_cut PROBABILITY INPUT_FILE UPDATES_FILE SEED" << std::endl;
+		return 1;
+	}
+
+	float success_probability { std::stof(argv[1], nullptr) };
+	uint32_t seed = { (uint32_t) std::stoi(argv[4]) };
+
+	MPI_Init(&argc, &argv);
+
+	SquareRootCut cutter(MPI_COMM_WORLD);
+
+	std::cout << std::fixed;
+
+	// Every rank reads the batches to know their number, only the master's edges are used
+	std::vector<AdjacencyListGraph::EdgeList> batches = readBatches(argv[3]);
+
+	auto print = [&](unsigned batch, SquareRootCut::Result const & res) {
+		std::cout << argv[2] << ","
+				  << seed << ","
+				  << cutter.processors() << ","
+				  << batch << ","
+				  << cutter.initialVertexCount() << ","
+				  << cutter.initialEdgeCount() << ","
+				  << res.cuttingTime << ","
+				  << res.mpiTime << ","
+				  << res.trials << ","
+				  << res.weight << std::endl;
+	};
+
+	if (cutter.master()) {
+		GraphInputIterator input(argv[2]);
+		print(0, cutter.runIncrementalMaster(input, success_probability, seed));
+	} else {
+		cutter.runIncrementalWorker();
+	}
+
+	for (unsigned batch = 0; batch < batches.size(); batch++) {
+		SquareRootCut::Result res = cutter.insertEdges(batches[batch]);
+		if (cutter.master()) {
+			print(batch + 1, res);
+		}
+	}
+
+	MPI_Finalize();
+}
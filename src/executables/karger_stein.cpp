@@ -3,15 +3,33 @@
 #include "sparse_graph.hpp"
 #include "stack_allocator.h"
 #include "co_mincut.h"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
 int main(int argc, char* argv[])
 {
-	if (argc != 3) {
-		std::cout << "Usage: karger_stein INPUT_FILE SEED" << std::endl;
+	if (argc < 3 || argc > 5) {
+		std::cout << "Usage: karger_stein INPUT_FILE SEED [THREADS [PAGES]]" << std::endl;
+		std::cout << "PAGES: heap (default), thp or huge -- backing of the large stack allocations" << std::endl;
 		return 1;
 	}
 
+	if (argc >= 4) {
+		thread_pool::set_global_threads(std::stoi(argv[3]));
+	}
+
+	if (argc == 5) {
+		std::string pages(argv[4]);
+		if (pages == "huge") {
+			stack_allocator::set_page_backing(huge_pages::RESERVED);
+		} else if (pages == "thp") {
+			stack_allocator::set_page_backing(huge_pages::TRANSPARENT);
+		} else if (pages != "heap") {
+			std::cout << "Unknown pages " << pages << ", expected heap, thp or huge" << std::endl;
+			return 1;
+		}
+	}
+
 	GraphInputIterator input(argv[1]);
 
 	uint32_t seed = { (uint32_t) std::stoi(argv[2]) };
@@ -44,4 +62,8 @@ int main(int argc, char* argv[])
 			  << "?" << ","
 			  << "co-karger-stein,"
 			  << cut_value << std::endl;
+
+	// Peak stack usage summed over the threads, excluding the input
+	std::cerr << "stack,"
+			  << stack_allocator::total_peak_usage() - allocator.peak_usage() << std::endl;
 }
@@ -0,0 +1,166 @@
+#include "dense_kernels.h"
+#include "../utils.hpp"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+
+using namespace dense_kernels;
+
+const instruction_set_t instruction_sets[] = { SCALAR, SSE42, AVX2, AVX512 };
+
+//Every variant has to agree with the scalar one, including the tails
+template<typename T>
+bool check_add_row(instruction_set_t set, std::mt19937 & generator) {
+	std::uniform_int_distribution<int> labels(0, 3);
+	for (int n = 0; n < 80; n++) {
+		std::vector<T> src(n), expected(n), actual(n);
+		std::vector<int> rep(n);
+		for (int k = 0; k < n; k++) {
+			src[k] = generator() % 1000;
+			expected[k] = actual[k] = generator() % 1000;
+			rep[k] = labels(generator);
+		}
+		T expected_sum = select_add_row<T>(SCALAR)(src.data(), expected.data(), rep.data(), 2, n);
+		T actual_sum = select_add_row<T>(set)(src.data(), actual.data(), rep.data(), 2, n);
+		if (expected != actual || expected_sum != actual_sum) return false;
+	}
+	return true;
+}
+
+//Gathers in place, like the compaction, which moves the row to lower addresses
+template<typename T>
+bool check_gather_row(instruction_set_t set, bool streaming, std::mt19937 & generator) {
+	for (int n = 1; n < 160; n++) {
+		std::vector<T> expected(2 * n), actual;
+		std::vector<int> columns;
+		for (int k = 0; k < n; k++) {
+			expected[n + k] = generator() % 1000;
+			if (generator() % 2) columns.push_back(k);
+		}
+		actual = expected;
+		int shift = generator() % (n + 1);
+		select_gather_row<T>(SCALAR)(expected.data() + n, columns.data(), columns.size(), expected.data() + shift, false);
+		select_gather_row<T>(set)(actual.data() + n, columns.data(), columns.size(), actual.data() + shift, streaming);
+		store_fence();
+		if (expected != actual) return false;
+	}
+	return true;
+}
+
+bool check_replace(instruction_set_t set, std::mt19937 & generator) {
+	std::uniform_int_distribution<int> labels(0, 3);
+	for (int n = 0; n < 80; n++) {
+		std::vector<int> expected(n);
+		for (int k = 0; k < n; k++) {
+			expected[k] = labels(generator);
+		}
+		std::vector<int> actual(expected);
+		select_replace(SCALAR)(expected.data(), n, 1, 3);
+		select_replace(set)(actual.data(), n, 1, 3);
+		if (expected != actual) return false;
+	}
+	return true;
+}
+
+//Prints kernel,instruction set,row length,nanoseconds per element
+void report(const std::string & kernel, instruction_set_t set, int n, int repetitions, double time) {
+	std::cout << kernel << ","
+			  << instruction_set_name(set) << ","
+			  << n << ","
+			  << time * 1e9 / ((double) n * repetitions) << std::endl;
+}
+
+//A contraction adds a row of the (cache resident) base case matrix for every edge
+template<typename T>
+void benchmark_add_row(const std::string & kernel, instruction_set_t set, int n, int repetitions, std::mt19937 & generator) {
+	std::vector<T> src(n), dest(n);
+	std::vector<int> rep(n);
+	for (int k = 0; k < n; k++) {
+		src[k] = generator() % 16;
+		rep[k] = k;
+	}
+	add_row_t<T> add_row = select_add_row<T>(set);
+
+	double time;
+	TimeUtils::measure<void>([&]() {
+		for (int r = 0; r < repetitions; r++) {
+			add_row(src.data(), dest.data(), rep.data(), r % n, n);
+		}
+	}, time);
+	report(kernel, set, n, repetitions, time);
+}
+
+//The compaction keeps about half of the columns
+template<typename T>
+void benchmark_gather_row(const std::string & kernel, instruction_set_t set, bool streaming, int n, int repetitions) {
+	std::vector<T> row(n), out(n / 2);
+	std::vector<int> columns(n / 2);
+	for (int k = 0; k < n / 2; k++) {
+		columns[k] = 2 * k + (k % 3 == 0);
+	}
+	gather_row_t<T> gather_row = select_gather_row<T>(set);
+
+	double time;
+	TimeUtils::measure<void>([&]() {
+		for (int r = 0; r < repetitions; r++) {
+			gather_row(row.data(), columns.data(), n / 2, out.data(), streaming);
+		}
+		store_fence();
+	}, time);
+	report(kernel, set, n / 2, repetitions, time);
+}
+
+void benchmark_replace(instruction_set_t set, int n, int repetitions) {
+	std::vector<int> rep(n);
+	for (int k = 0; k < n; k++) {
+		rep[k] = k;
+	}
+	replace_t replace = select_replace(set);
+
+	//every union merges a singleton, like the bulk unions of a contraction sequence
+	double time;
+	TimeUtils::measure<void>([&]() {
+		for (int r = 0; r < repetitions; r++) {
+			replace(rep.data(), n, r % n, (r + 1) % n);
+		}
+	}, time);
+	report("bulk_union", set, n, repetitions, time);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 3) {
+		std::cout << "Usage: kernel_benchmark [ROW_LENGTH] [REPETITIONS]" << std::endl;
+		return 1;
+	}
+
+	int n = argc > 1 ? std::stoi(argv[1]) : 1024;
+	int repetitions = argc > 2 ? std::stoi(argv[2]) : 100000;
+
+	std::cerr << "detected instruction set: " << instruction_set_name(detected_instruction_set()) << std::endl;
+
+	std::mt19937 generator(42);
+	bool correct = true;
+
+	for (instruction_set_t set : instruction_sets) {
+		if (!is_supported(set)) continue;
+
+		if (!check_replace(set, generator) || !check_add_row<int32_t>(set, generator) || !check_add_row<int64_t>(set, generator)
+				|| !check_gather_row<int32_t>(set, false, generator) || !check_gather_row<int64_t>(set, false, generator)
+				|| !check_gather_row<int32_t>(set, true, generator) || !check_gather_row<int64_t>(set, true, generator)) {
+			std::cerr << instruction_set_name(set) << " kernels differ from the scalar ones" << std::endl;
+			correct = false;
+		}
+
+		benchmark_replace(set, n, repetitions);
+		benchmark_add_row<int32_t>("add_row_32", set, n, repetitions, generator);
+		benchmark_add_row<int64_t>("add_row_64", set, n, repetitions, generator);
+		benchmark_gather_row<int32_t>("gather_row_32", set, false, n, repetitions);
+		benchmark_gather_row<int64_t>("gather_row_64", set, false, n, repetitions);
+		benchmark_gather_row<int32_t>("stream_gather_row_32", set, true, n, repetitions);
+		benchmark_gather_row<int64_t>("stream_gather_row_64", set, true, n, repetitions);
+	}
+
+	return correct ? 0 : 1;
+}
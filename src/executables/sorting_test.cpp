@@ -9,7 +9,15 @@
 
 using namespace std;
 
+SamplingSorterBase::Algorithm algorithm = SamplingSorterBase::AUTO;
+
 int main(int argc, char* argv[]) {
+	// --algorithm=single|multi forces the single-level or the multi-level sort
+	std::map<std::string, std::string> options = ArgUtils::extractOptions(argc, argv);
+	if (options.count("algorithm")) {
+		algorithm = options.at("algorithm") == "multi" ? SamplingSorterBase::MULTI_LEVEL : SamplingSorterBase::SINGLE_LEVEL;
+	}
+
 	MPI_Init(&argc, &argv);
 	int rank, p;
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -26,7 +34,8 @@ int main(int argc, char* argv[]) {
 	vector<int> data(10000);
 	generate(begin(data), end(data), gen);
 
-	SamplingSorter<int> sorter(MPI_COMM_WORLD, move(data), rank);
+	SamplingSorter<int> sorter(MPI_COMM_WORLD, move(data));
+	sorter.setAlgorithm(algorithm);
 	vector<int> result = sorter.sort();
 
 	// Verify sortedness across slices
@@ -63,5 +72,74 @@ int main(int argc, char* argv[]) {
 		);
 	}
 
+	if (rank == 0) {
+		cout << "imbalance," << sorter.imbalance() << endl;
+	}
+
+	// Edges go through the radix path. Many duplicate keys, and enough elements to skip the std::sort cutoff
+	uniform_int_distribution<unsigned> vertex(0, 1000);
+	vector<AdjacencyListGraph::Edge> edges(10000);
+	for (auto & edge : edges) {
+		edge = { vertex(mersenne_engine), vertex(mersenne_engine), 1 };
+	}
+
+	SamplingSorter<AdjacencyListGraph::Edge> edge_sorter(MPI_COMM_WORLD, move(edges));
+	edge_sorter.setAlgorithm(algorithm);
+	vector<AdjacencyListGraph::Edge> sorted_edges = edge_sorter.sort();
+
+	if (!std::is_sorted(sorted_edges.begin(), sorted_edges.end())) {
+		throw std::runtime_error("Edge slice is not sorted!");
+	}
+
+	unsigned long local_count = sorted_edges.size(), count;
+	MPI_Reduce(&local_count, &count, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+	vector<AdjacencyListGraph::Edge> edge_boundaries(2 * p);
+	vector<AdjacencyListGraph::Edge> my_edge_boundaries { sorted_edges.front(), sorted_edges.back() };
+	MPI_Gather(
+			my_edge_boundaries.data(),
+			2,
+			MPIDatatype<AdjacencyListGraph::Edge>::constructType(),
+			edge_boundaries.data(),
+			2,
+			MPIDatatype<AdjacencyListGraph::Edge>::constructType(),
+			0,
+			MPI_COMM_WORLD
+	);
+
+	if (rank == 0) {
+		cout << "imbalance," << edge_sorter.imbalance() << endl;
+		if (count != 10000ul * p) {
+			throw std::runtime_error("Edges got lost!");
+		}
+		if (!std::is_sorted(edge_boundaries.begin(), edge_boundaries.end())) {
+			throw std::runtime_error("Some edge slices are not sorted!");
+		}
+	}
+
+	// Heavily contracted graph: only a handful of distinct edges
+	uniform_int_distribution<unsigned> few_vertices(0, 2);
+	vector<AdjacencyListGraph::Edge> duplicates(10000);
+	for (auto & edge : duplicates) {
+		edge = { few_vertices(mersenne_engine), few_vertices(mersenne_engine), 1 };
+	}
+
+	SamplingSorter<AdjacencyListGraph::Edge> duplicates_sorter(MPI_COMM_WORLD, move(duplicates));
+	duplicates_sorter.setAlgorithm(algorithm);
+	vector<AdjacencyListGraph::Edge> sorted_duplicates = duplicates_sorter.sort();
+
+	if (!std::is_sorted(sorted_duplicates.begin(), sorted_duplicates.end())) {
+		throw std::runtime_error("Duplicate slice is not sorted!");
+	}
+
+	// Regular sampling with tie-breaking bounds the largest slice regardless of duplicates
+	if (duplicates_sorter.imbalance() > 1.5) {
+		throw std::runtime_error("Duplicates are not balanced!");
+	}
+
+	if (rank == 0) {
+		cout << "duplicates imbalance," << duplicates_sorter.imbalance() << endl;
+	}
+
 	MPI_Finalize();
 }
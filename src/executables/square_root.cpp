@@ -1,20 +1,119 @@
 #include "../SquareRootCut.hpp"
 #include "input/GraphInputIterator.hpp"
 #include "../utils.hpp"
+#include "../ExecutionPlanner.hpp"
+#include "thread_pool.hpp"
+#include "stack_allocator.h"
 
 int main(int argc, char* argv[])
 {
+	std::map<std::string, std::string> options = ArgUtils::extractOptions(argc, argv);
+
 	if ((argc != 4) && (argc != 5)) {
-		std::cout << "Usage: square_root PROBABILITY INPUT_FILE|CLICK [SIZE] SEED" << std::endl;
+		std::cout << "Usage: square_root [--placement=pack|spread] [--threads=N] [--pages=heap|thp|huge] [--plan=default|auto] [--memory=GB] [--checkpoint=DIR [--restart] [--checkpoint-interval=SECONDS]] PROBABILITY INPUT_FILE|CLICK [SIZE] SEED" << std::endl;
 		return 1;
 	}
 
+	SquareRootCut::GroupPlacement placement = SquareRootCut::PACK;
+	if (options.count("placement")) {
+		if (options.at("placement") == "spread") {
+			placement = SquareRootCut::SPREAD;
+		} else if (options.at("placement") != "pack") {
+			std::cout << "Unknown placement " << options.at("placement") << ", expected pack or spread" << std::endl;
+			return 1;
+		}
+	}
+
+	// Backing of the large stack allocations of the base case
+	if (options.count("pages")) {
+		std::string pages = options.at("pages");
+		if (pages == "huge") {
+			stack_allocator::set_page_backing(huge_pages::RESERVED);
+		} else if (pages == "thp") {
+			stack_allocator::set_page_backing(huge_pages::TRANSPARENT);
+		} else if (pages != "heap") {
+			std::cout << "Unknown pages " << pages << ", expected heap, thp or huge" << std::endl;
+			return 1;
+		}
+	}
+
 	float success_probability { std::stof(argv[1], nullptr) };
 	uint32_t seed = { (uint32_t) std::stoi(argv[argc == 4 ? 3 : 4]) };
 
-	MPI_Init(&argc, &argv);
+	// Threads per process for the dense contraction kernels. Only the main thread calls MPI
+	int threads = options.count("threads") ? std::stoi(options.at("threads")) : 1;
+	if (threads > 1) {
+		int provided;
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+		if (provided < MPI_THREAD_FUNNELED) {
+			std::cerr << "MPI_THREAD_FUNNELED is not supported, running with one thread per process" << std::endl;
+			threads = 1;
+		}
+	} else {
+		MPI_Init(&argc, &argv);
+	}
+	thread_pool::set_global_threads(threads);
 
-	SquareRootCut cutter(MPI_COMM_WORLD);
+	double base_case_multiplier = 2;
+	bool planned = options.count("plan") && options.at("plan") == "auto";
+	ExecutionPlanner::Plan plan;
+
+	if (planned) {
+		unsigned n, m;
+		if (std::string(argv[2]) == "CLICK") {
+			n = (unsigned) std::stoul(argv[3]);
+			m = n * (n - 1) / 2;
+		} else {
+			GraphInputIterator input(argv[2]);
+			n = input.vertexCount();
+			m = input.edgeCount();
+		}
+
+		double memory = options.count("memory") ? std::stod(options.at("memory")) * (1 << 30) : 0;
+		ExecutionPlanner planner(ExecutionPlanner::calibrate(MPI_COMM_WORLD, memory));
+
+		int p;
+		MPI_Comm_size(MPI_COMM_WORLD, &p);
+		plan = planner.plan(n, m, (unsigned) p, success_probability);
+
+		// CLICK inputs are generated on the fly and only support HC
+		if (std::string(argv[2]) == "CLICK" && plan.variant == SquareRootCut::LOW_CONCURRENCY) {
+			std::vector<ExecutionPlanner::Plan> plans = planner.candidates(n, m, (unsigned) p, success_probability);
+			auto high = std::find_if(plans.begin(), plans.end(), [](const ExecutionPlanner::Plan & candidate) {
+				return candidate.variant == SquareRootCut::HIGH_CONCURRENCY;
+			});
+			planned = high != plans.end();
+			if (planned) {
+				plan = *high;
+			}
+		}
+
+		if (planned) {
+			base_case_multiplier = plan.base_case_multiplier;
+		}
+	}
+
+	SquareRootCut cutter(MPI_COMM_WORLD, base_case_multiplier, placement);
+
+	if (options.count("checkpoint")) {
+		cutter.enableCheckpointing(
+				options.at("checkpoint"),
+				options.count("restart") > 0,
+				options.count("checkpoint-interval") ? std::stod(options.at("checkpoint-interval")) : 60
+		);
+	}
+
+	if (planned) {
+		cutter.overridePlan(plan.variant, plan.group_size);
+
+		if (cutter.master()) {
+			std::cerr << "plan,"
+					  << (plan.variant == SquareRootCut::Variant::HIGH_CONCURRENCY ? "high" : "low") << ","
+					  << plan.group_size << ","
+					  << plan.base_case_multiplier << ","
+					  << plan.predicted_time << std::endl;
+		}
+	}
 
 	std::cout << std::fixed;
 
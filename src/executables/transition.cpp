@@ -3,6 +3,7 @@
 
 #include "mpi.h"
 #include "../SquareRootCut.hpp"
+#include "../ExecutionPlanner.hpp"
 #include <iostream>
 #include <iomanip>
 
@@ -23,8 +24,15 @@ int main(int argc, char* argv[])
 
 
 	SquareRootCut cutter(MPI_COMM_WORLD);
+	// Calibrated on the current allocation
+	ExecutionPlanner planner(ExecutionPlanner::calibrate(MPI_COMM_WORLD));
 
-	std::cout << "Processors  " << "Total trials  " << "Trials per CPU" << std::endl;
+	if (!cutter.master()) {
+		MPI_Finalize();
+		return 0;
+	}
+
+	std::cout << "Processors  " << "Total trials  " << "Trials per CPU  " << "Plan (variant, group size, multiplier, predicted time)" << std::endl;
 	for (unsigned processors = 1; processors <= maxp; processors += granularity) {
 		unsigned trials = cutter.numberOfTrials(n, m, success_probability);
 		unsigned tpcpu = (unsigned) std::ceil(double(trials) / processors);
@@ -42,6 +50,14 @@ int main(int argc, char* argv[])
 			std::cout << "* " << processors_per_trial << ", groups size " << group_size;
 		}
 
+		ExecutionPlanner::Plan plan = planner.plan(n, m, processors, success_probability);
+		std::cout << "  | " << (plan.variant == SquareRootCut::Variant::HIGH_CONCURRENCY ? "high" : "low")
+				  << ", " << plan.group_size
+				  << ", " << plan.base_case_multiplier
+				  << ", " << plan.predicted_time;
+
 		std::cout << std::endl;
 	}
+
+	MPI_Finalize();
 }
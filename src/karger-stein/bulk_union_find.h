@@ -13,9 +13,6 @@
 
 class bulk_union_find {
 
-private:
-    void bulk_union_avx(int u, int v);
-    void bulk_union_avx_unroll(int u, int v);
 public:
     int length;
     int number_of_sets;
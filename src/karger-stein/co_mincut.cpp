@@ -29,6 +29,11 @@ namespace comincut {
         return depth;
     }
 
+    stack_allocator * thread_stack() {
+        static thread_local stack_allocator stack(0);
+        return &stack;
+    }
+
     double min_success_in_one_trial(int number_of_vertices) {
 
         if (number_of_vertices <= base_case_size) return 1;
@@ -13,16 +13,20 @@
 #include "lazy_adjacency_matrix.hpp"
 #include "sparse_graph.hpp"
 #include <thread>
+#include <atomic>
 #include "lazy_adjacency_matrix.hpp"
 #include "indexed_adjacency_matrix.hpp"
 #include "test/testing_utility.h"
 #include "co_mincut_base_case.hpp"
+#include "thread_pool.hpp"
 
 
 namespace comincut {
     const int recursive_fanout = 2;
     const int base_case_size = 128;
     const int sparse_base_case_size = 512;
+    //The branches of graphs with fewer vertices are not worth a task of their own
+    const int task_size = 2 * base_case_size;
 
     int target_number_of_vertices_for_contraction(int capacity);
 
@@ -30,9 +34,33 @@ namespace comincut {
 
     double min_success_in_one_trial(int number_of_vertices);
 
+    //The stack of the calling thread, used by the trials and the branches it runs. It is kept for the lifetime of the
+    //thread, so that repeated calls do not allocate it again (it keeps the largest size it has grown to)
+    stack_allocator * thread_stack();
+
     //returns an upperbound on the number of trials needed to get the desired success probability
     int number_of_trials(int number_of_vertices, double success_probability);
 
+    //Estimates of the stack space used by one trial, which is reserved (and touched by the thread running the trials) before they start.
+    //Each of the depth_of_recursion levels holds a copy of the graph: the dense copies shrink with the number of vertices,
+    //the number of edges of the sparse ones is bounded by the input
+    template <class T>
+    long trial_space_estimate(indexed_adjacency_matrix<T> * graph) {
+        long space = 0;
+        int vertices = graph->number_of_vertices();
+        for (int level=0; level<=depth_of_recursion(graph->number_of_vertices()); ++level) {
+            //the matrix and the capacities with their sum trees
+            space += lazy_adjacency_matrix<T>::space_requirement(vertices) + 8 * sizeof(T) * (long)vertices;
+            vertices = target_number_of_vertices_for_contraction(vertices);
+        }
+        return space;
+    }
+
+    template <class T>
+    long trial_space_estimate(sparse_graph<T, edge<T>> * graph) {
+        return (depth_of_recursion(graph->number_of_vertices()) + 1) * (long)graph->number_of_edges() * sizeof(edge<T>);
+    }
+
     //Dense random contraction
     //Writes a lowerbound on the success probability to success
     template<class T>
@@ -155,11 +183,71 @@ namespace comincut {
     }
 
 
+    ////
+    //Task parallel recursion
+    ////
+
+    //Upper bound on the minimum cut, shared by the branches of the recursion, which may run concurrently
+    //Every cut found lowers it right away, so that all branches can contract the edges which are at least as heavy
+    template <class T>
+    class shared_upper_bound {
+
+        std::atomic<T> value;
+
+    public:
+
+        explicit shared_upper_bound(T value) : value(value) {}
+
+        T get() const {
+            return value.load();
+        }
+
+        void update(T cut) {
+            T current = value.load();
+            while (cut < current && !value.compare_exchange_weak(current, cut)) {}
+        }
+    };
+
+    inline bool branches_run_as_tasks(int number_of_vertices) {
+        return number_of_vertices >= task_size && thread_pool::global().size() > 1;
+    }
+
+    //Calls branch(i, random_engine, stack) for i = 0, ..., recursive_fanout-1 and returns once all calls are done
+    //If branches_run_as_tasks, all but the last branch are tasks of the global thread pool, with their own random engine
+    //seeded from random_engine, and use the thread_stack of the thread running them. Otherwise, the branches run one after
+    //the other on random_engine and stack, as in the sequential algorithm. The tasks lower the shared upper bound in the
+    //order they finish, so their results depend on the scheduling
+    template <class Branch>
+    void run_branches(int number_of_vertices, sitmo::prng_engine * random_engine, stack_allocator * stack, const Branch & branch) {
+
+        if (!branches_run_as_tasks(number_of_vertices)) {
+            for (int i=0; i<recursive_fanout; ++i) {
+                branch(i, random_engine, stack);
+            }
+            return;
+        }
+
+        task_group branches;
+
+        for (int i=0; i<recursive_fanout-1; ++i) {
+            uint32_t seed = (*random_engine)();
+
+            branches.run([&branch, i, seed] {
+                sitmo::prng_engine task_engine(seed);
+                branch(i, &task_engine, thread_stack());
+            });
+        }
+
+        branch(recursive_fanout-1, random_engine, stack);
+
+        branches.wait();
+    }
+
     template <class T>
-    T recursive_contraction(indexed_adjacency_matrix<T> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, T upper_bound, bool preserve_input_graph, double * success_probability);
+    T recursive_contraction(indexed_adjacency_matrix<T> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, shared_upper_bound<T> * upper_bound, bool preserve_input_graph, double * success_probability);
 
     template <class T>
-    T recursive_contraction(sparse_graph<T, edge<T>> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, T upper_bound, bool preserve_input_graph, double * success_probability);
+    T recursive_contraction(sparse_graph<T, edge<T>> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, shared_upper_bound<T> * upper_bound, bool preserve_input_graph, double * success_probability);
 
     template <class T>
     double minimum_cut_trials_start(adjacency_matrix<T> * graph, T * degrees, T * result, int seed, double min_success);
@@ -170,11 +258,11 @@ namespace comincut {
     //Stores a lower bound on the correctness probability in success_probability
     //See [Karger-Stein 1996 A New Approach ...] for an overview
     //Uses random_engine to generate the random numbers, stack to allocate memory
-    //A precondition is that upper_bound is an upperbound on the minimum cut value of the graph
+    //A precondition is that upper_bound is an upperbound on the minimum cut value of the graph. It is lowered by every cut found
     //The GraphT type must be such that contract_graph can be used with it (either sparse_graph<T, edge<T>> or indexed_adjacency_matrix<T>)
 
     template <class T, class GraphT>
-    T recursive_contraction_inner(GraphT * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, T upper_bound, bool preserve_input_graph, double * success_probability) {
+    T recursive_contraction_inner(GraphT * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, shared_upper_bound<T> * upper_bound, bool preserve_input_graph, double * success_probability) {
 
         stack_state saved_stack_state = stack->enter();
 
@@ -185,41 +273,38 @@ namespace comincut {
 
         const int target_vertices = target_number_of_vertices_for_contraction(graph->number_of_vertices());
 
-        for (int i=0; i<recursive_fanout; ++i) {
+        //In the last branch we can destroy the input graph, unless it is preserved or still copied by the other branches
+        const bool destroy_input_graph = !preserve_input_graph && !branches_run_as_tasks(graph->number_of_vertices());
 
-            T cut;
+        run_branches(graph->number_of_vertices(), random_engine, stack, [&](int i, sitmo::prng_engine * branch_engine, stack_allocator * branch_stack) {
 
-            if (i==recursive_fanout-1 && !preserve_input_graph) {
-                //in the last iteration we can destroy the input graph
-                contract_graph(graph, random_engine, stack, target_vertices, upper_bound, &contraction_success[i]);
+            if (i==recursive_fanout-1 && destroy_input_graph) {
+                contract_graph(graph, branch_engine, branch_stack, target_vertices, upper_bound->get(), &contraction_success[i]);
 
-                cut = recursive_contraction<T>(graph, random_engine, stack, upper_bound, false, &success_probabilities[i]);
+                recursive_contraction<T>(graph, branch_engine, branch_stack, upper_bound, false, &success_probabilities[i]);
 
             } else {
 
-                stack_state saved_stack_state_inner = stack->enter();
+                stack_state saved_stack_state_inner = branch_stack->enter();
 
-                //in all the other iterations, create a copy of the input graph before contracting
-                GraphT contracted_graph(graph, stack);
+                //in all the other branches, create a copy of the input graph before contracting
+                GraphT contracted_graph(graph, branch_stack);
 
-                contract_graph(&contracted_graph, random_engine, stack, target_vertices, upper_bound, &contraction_success[i]);
+                contract_graph(&contracted_graph, branch_engine, branch_stack, target_vertices, upper_bound->get(), &contraction_success[i]);
 
                 assert (contracted_graph.number_of_vertices() <= target_vertices);
 
-                cut = recursive_contraction<T>(&contracted_graph, random_engine, stack, upper_bound, false, &success_probabilities[i]);
+                recursive_contraction<T>(&contracted_graph, branch_engine, branch_stack, upper_bound, false, &success_probabilities[i]);
 
-
-                stack->leave(saved_stack_state_inner);
+                branch_stack->leave(saved_stack_state_inner);
             }
-
-            upper_bound = std::min(upper_bound, cut);
-        }
+        });
 
         *success_probability = (double)1.0 - ((double)1.0 - contraction_success[0] * success_probabilities[0]) * ((double)1.0 - contraction_success[1] * success_probabilities[1]);
 
         stack->leave(saved_stack_state);
 
-        return upper_bound;
+        return upper_bound->get();
     }
 
     ///
@@ -227,11 +312,11 @@ namespace comincut {
     //Stores a lower bound on the correctness probability in success_probability
     //See [Karger-Stein 1996 A New Approach ...] for an overview
     //Uses random_engine to generate the random numbers, stack to allocate memory
-    //A precondition is that upper_bound is an upperbound on the minimum cut value of the graph
+    //A precondition is that upper_bound is an upperbound on the minimum cut value of the graph. It is lowered by every cut found
     //The GraphT type must be such that contract_graph can be used with it (either sparse_graph<T, edge<T>> or indexed_adjacency_matrix<T>)
 
     template <class T, class GraphT>
-    T recursive_contraction_half(GraphT * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, T upper_bound) {
+    T recursive_contraction_half(GraphT * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, shared_upper_bound<T> * upper_bound) {
 
         stack_state saved_stack_state = stack->enter();
 
@@ -241,48 +326,49 @@ namespace comincut {
 
 
         if (graph->number_of_vertices() <= base_case_size) {//Base case
-            upper_bound = deterministic_cut_pr(graph, stack, upper_bound);
+            upper_bound->update(deterministic_cut_pr(graph, stack, upper_bound->get()));
 
         } else {
 
-            contract_graph(graph, random_engine, stack, target_vertices, upper_bound, &contraction_success);
+            contract_graph(graph, random_engine, stack, target_vertices, upper_bound->get(), &contraction_success);
 
-            for (int i=0; i<recursive_fanout; ++i) {
-                stack_state saved_stack_state2 = stack->enter();
+            //the branches only read the graph, so each of them copies it by itself
+            run_branches(graph->number_of_vertices(), random_engine, stack, [&](int, sitmo::prng_engine * branch_engine, stack_allocator * branch_stack) {
+                stack_state saved_stack_state2 = branch_stack->enter();
 
-                GraphT contracted_graph(graph, stack);
+                GraphT contracted_graph(graph, branch_stack);
 
-                T cut = recursive_contraction_half<T>(&contracted_graph, random_engine, stack, upper_bound);
+                recursive_contraction_half<T>(&contracted_graph, branch_engine, branch_stack, upper_bound);
 
-                upper_bound = std::min(upper_bound, cut);
-
-                stack->leave(saved_stack_state2);
-            }
+                branch_stack->leave(saved_stack_state2);
+            });
         }
 
         stack->leave(saved_stack_state);
 
-        return upper_bound;
+        return upper_bound->get();
     }
 
 
 
     template <class T>
-    T recursive_contraction(indexed_adjacency_matrix<T> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, T upper_bound, bool preserve_input_graph, double * success_probability) {
+    T recursive_contraction(indexed_adjacency_matrix<T> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, shared_upper_bound<T> * upper_bound, bool preserve_input_graph, double * success_probability) {
         if (graph->number_of_vertices() <= base_case_size) {
             *success_probability = 1.0;
-            return deterministic_cut_pr<T>(graph, stack, upper_bound);
+            upper_bound->update(deterministic_cut_pr<T>(graph, stack, upper_bound->get()));
+            return upper_bound->get();
         }
 
         return recursive_contraction_inner<T, indexed_adjacency_matrix<T>>(graph, random_engine, stack, upper_bound, preserve_input_graph, success_probability);
     }
 
     template <class T>
-    T recursive_contraction(sparse_graph<T, edge<T>> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, T upper_bound, bool preserve_input_graph, double * success_probability) {
+    T recursive_contraction(sparse_graph<T, edge<T>> * graph, sitmo::prng_engine * random_engine, stack_allocator * stack, shared_upper_bound<T> * upper_bound, bool preserve_input_graph, double * success_probability) {
 
         if (graph->number_of_edges() <= sparse_base_case_size || graph->number_of_vertices() <= base_case_size) {
             *success_probability = 1.0;
-            return deterministic_cut_pr<T>(graph, stack, upper_bound);
+            upper_bound->update(deterministic_cut_pr<T>(graph, stack, upper_bound->get()));
+            return upper_bound->get();
         }
 
         /*
@@ -308,20 +394,28 @@ namespace comincut {
     }
 
 
+    template <class T, class graphT>
+    T minimum_cut_trials_parallelize(graphT * graph, stack_allocator * stack, T upper_bound, int seed, double min_success);
+
     ////
     //Performs as many trials as necessary to guarantee with probability min_success that the result is the mincut value
+    //If there are several trials and the global thread pool has more than one thread, the trials run on all of them (see minimum_cut_trials_parallelize)
     ////
 
     template <class T, class graphT>
     T minimum_cut_trials(graphT * graph, stack_allocator * stack, T upper_bound, int seed, double min_success) {
 
+        const int max_trials = number_of_trials(graph->number_of_vertices(), min_success);
+        assert (max_trials > 0);
+
+        if (max_trials > 1 && thread_pool::global().size() > 1) {
+            return minimum_cut_trials_parallelize<T>(graph, stack, upper_bound, seed, min_success);
+        }
+
         //Parallel random number generator assures that if seeds for this call are different, then the streams produced are independent
         sitmo::prng_engine random_engine(seed);
 
-        T min_so_far = upper_bound;
-
-        const int max_trials = number_of_trials(graph->number_of_vertices(), min_success);
-        assert (max_trials > 0);
+        shared_upper_bound<T> min_so_far(upper_bound);
         //double failure_so_far = 1.0;
         
         //int vertices = graph->number_of_vertices();
@@ -329,22 +423,79 @@ namespace comincut {
         for (int i=0; i<max_trials; ++i) {
             double ad_hoc_success;
 
-            T cut = recursive_contraction<T> (graph, &random_engine, stack, min_so_far, true, &ad_hoc_success);
-
-            min_so_far = std::min(min_so_far, cut);
+            recursive_contraction<T> (graph, &random_engine, stack, &min_so_far, true, &ad_hoc_success);
 
             //failure_so_far = failure_so_far * (1.0-ad_hoc_success);
 
-            //std::cout << "c number of vertices " << vertices << ", mincut so far " << cut << ", ad hoc success " << ad_hoc_success << " failure so far " << failure_so_far << std::endl;
+            //std::cout << "c number of vertices " << vertices << ", mincut so far " << min_so_far.get() << ", ad hoc success " << ad_hoc_success << " failure so far " << failure_so_far << std::endl;
+        }
+
+        return min_so_far.get();
+    }
+
+    ////
+    //Performs the trials of minimum_cut_trials on the global thread pool
+    //Every thread pulls the next trial from a shared counter, so the threads which draw cheap trials (e.g. thanks to a good upper bound) do more of them
+    //Trial i uses its own random engine, seeded with the i-th number drawn from seed, and contracts a copy of the graph on the stack of its thread
+    //The trials therefore differ from those of minimum_cut_trials for the same seed, and as the bound seen by a trial depends on
+    //the trials finished before it, the result is not reproducible from run to run
+    ////
+
+    template <class T, class graphT>
+    T minimum_cut_trials_parallelize(graphT * graph, stack_allocator * stack, T upper_bound, int seed, double min_success) {
+
+        sitmo::prng_engine random_engine(seed);
+
+        shared_upper_bound<T> min_so_far(upper_bound);
+
+        const int max_trials = number_of_trials(graph->number_of_vertices(), min_success);
+        assert (max_trials > 0);
+
+        std::vector<uint32_t> trial_seeds(max_trials);
+        for (int i=0; i<max_trials; ++i) {
+            trial_seeds[i] = random_engine();
+        }
+
+        std::atomic<int> next_trial(0);
+
+        const long trial_space = trial_space_estimate(graph);
+
+        auto run_trials = [&](stack_allocator * trial_stack) {
+            trial_stack->reserve(trial_space);
+
+            for (int i = next_trial++; i < max_trials; i = next_trial++) {
+                stack_state saved_stack_state = trial_stack->enter();
+
+                graphT trial_graph(graph, trial_stack);
+                sitmo::prng_engine trial_engine(trial_seeds[i]);
+                double ad_hoc_success;
+
+                recursive_contraction<T> (&trial_graph, &trial_engine, trial_stack, &min_so_far, false, &ad_hoc_success);
+
+                trial_stack->leave(saved_stack_state);
+            }
+        };
+
+        thread_pool & pool = thread_pool::global();
+
+        task_group trials(pool);
+
+        for (int t=1; t<std::min(pool.size(), max_trials); ++t) {
+            trials.run([&run_trials] { run_trials(thread_stack()); });
         }
 
-        return min_so_far;
+        run_trials(stack);
+
+        trials.wait();
+
+        return min_so_far.get();
     }
 
     template <class T>
     void minimum_cut_trials_start_try(adjacency_matrix<T> * graph, T * result, int seed) {
 
-        stack_allocator * stack = new stack_allocator(0);
+        stack_allocator * stack = thread_stack();
+        stack_state saved_stack_state = stack->enter();
 
         array<T> capacities = stack->allocate<T>(graph->number_of_vertices());
 
@@ -352,25 +503,28 @@ namespace comincut {
 
         indexed_adjacency_matrix<T> indexed_graph(graph, capacities, stack);
 
-        T min_so_far = *std::min_element(capacities.begin(), capacities.end());
+        stack->reserve(trial_space_estimate(&indexed_graph));
+
+        shared_upper_bound<T> min_so_far(*std::min_element(capacities.begin(), capacities.end()));
 
         //std::cout << "cheapest 1 vertex cut " << min_so_far << std::endl;
 
         sitmo::prng_engine random_engine(seed);
 
-        *result = recursive_contraction_half<T, indexed_adjacency_matrix<T>>(&indexed_graph, &random_engine, stack, min_so_far);
+        *result = recursive_contraction_half<T, indexed_adjacency_matrix<T>>(&indexed_graph, &random_engine, stack, &min_so_far);
 
-        delete stack;
+        stack->leave(saved_stack_state);
     }
 
     ///
-    //allocates the call stack and converts the graph into the correct representation (for dense input graph)
+    //converts the graph into the correct representation on the stack of the calling thread (for dense input graph)
     ///
 
     template <class T>
     void minimum_cut_trials_start(adjacency_matrix<T> * graph, T * result, int seed, double min_success) {
 
-        stack_allocator * stack = new stack_allocator(0);
+        stack_allocator * stack = thread_stack();
+        stack_state saved_stack_state = stack->enter();
 
         array<T> capacities = stack->allocate<T>(graph->number_of_vertices());
 
@@ -378,6 +532,8 @@ namespace comincut {
 
         indexed_adjacency_matrix<T> indexed_graph(graph, capacities, stack);
 
+        stack->reserve(trial_space_estimate(&indexed_graph));
+
         T min_so_far = *std::min_element(capacities.begin(), capacities.end());
 
         //std::cout << "cheapest 1 vertex cut " << min_so_far << std::endl;
@@ -386,17 +542,18 @@ namespace comincut {
 
         *result = min_so_far;
 
-        delete stack;
+        stack->leave(saved_stack_state);
     }
 
     ///
-    //allocates the call stack and converts the graph into the correct representation (for sparse input graph)
+    //converts the graph into the correct representation on the stack of the calling thread (for sparse input graph)
     ///
 
     template <class T>
     void minimum_cut_trials_start(sparse_graph<T, edge<T>> * graph, T * result, int seed, double min_success) {
 
-        stack_allocator * stack = new stack_allocator(0);
+        stack_allocator * stack = thread_stack();
+        stack_state saved_stack_state = stack->enter();
 
         if (graph->number_of_edges() >= (long long)graph->number_of_vertices() * graph->number_of_vertices() / 32) {
 
@@ -405,53 +562,14 @@ namespace comincut {
             minimum_cut_trials_start(&dense_graph, result, seed, min_success);
         } else {
 
-            //stack->reserve(128 * (graph->number_of_edges()+graph->number_of_vertices()) * (long)(depth_of_recursion(graph->number_of_vertices()+1)));
+            stack->reserve(trial_space_estimate(graph));
 
             *result = minimum_cut_trials<T>(graph, stack, std::numeric_limits<T>::max(), seed, min_success);
         }
 
-        delete stack;
-    }
-
-    ////
-    //Calls num_threads batches of trials in parallel (if num_threads = 1, no additional thread is created)
-    ////
-
-    template <class T, class graphT>
-    T minimum_cut_trials_parallelize(graphT * graph, int seed, double min_success, int num_threads) {
-
-        double success_per_thread = 1-(pow(1-min_success, 1.0/num_threads));
-
-//#ifndef NDEBUG
-//        std::cout << "success per thread " << success_per_thread << std::endl;
-//#endif
-
-        std::vector<std::thread> threads;
-
-        T * results = new T[num_threads];
-
-        for (int i=0; i<num_threads-1; ++i) {
-            threads.push_back(std::thread([=] {
-                minimum_cut_trials_start<T>(graph, results+i, seed+i, success_per_thread);
-            }));
-        }
-
-        minimum_cut_trials_start<T>(graph, &results[num_threads-1], seed+num_threads-1, success_per_thread);
-
-        for(auto& thread : threads){
-            thread.join();
-        }
-
-        T min = *std::min_element(results, results+num_threads);
-
-        delete[] results;
-        //delete threads;
-        //free(threads);
-
-        return min;
+        stack->leave(saved_stack_state);
     }
 
-
     ////
     //Public Functions
     ////
@@ -531,11 +649,12 @@ namespace comincut {
         
         assert (is_connected(graph));
         
-        stack_allocator * stack = new stack_allocator(0);
+        stack_allocator * stack = thread_stack();
+        stack_state saved_stack_state = stack->enter();
 
         T result = deterministic_cut_pr<T>(graph, stack, std::numeric_limits<T>::max());
 
-        delete stack;
+        stack->leave(saved_stack_state);
 
         return result;
     }
@@ -16,8 +16,6 @@
 #include "math.h"
 #include <algorithm>
 #include <functional> //std:: minus
-#include <immintrin.h>
-#include <x86intrin.h>
 #include "prng_engine.hpp"
 #include <thread>
 #include <limits>
@@ -0,0 +1,428 @@
+//
+//  dense_kernels.cpp
+//
+//  The vector variants only use the instructions of their target attribute, so they can be compiled without
+//  -march (the scalar variants are left to the auto-vectorizer of the baseline target).
+//
+
+#include "dense_kernels.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define DENSE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace dense_kernels {
+
+    namespace {
+
+        void replace_scalar(int * rep, int length, int u, int v) {
+            for (int i=0; i<length; i++) {
+                if (rep[i] == u) {
+                    rep[i] = v;
+                }
+            }
+        }
+
+        template <typename T>
+        T add_row_scalar(const T * src, T * dest, const int * rep, int label, int n) {
+            T sum = (T)0;
+            for (int k=0; k<n; k++) {
+                dest[k] = rep[k] == label ? (T)0 : dest[k] + src[k];
+                sum += dest[k];
+            }
+            return sum;
+        }
+
+        //the scalar gathers go front to back, which is what the in place compaction needs
+        template <typename T>
+        void gather_row_scalar(const T * row, const int * columns, int n, T * out, bool) {
+            for (int k=0; k<n; k++) {
+                out[k] = row[columns[k]];
+            }
+        }
+
+#ifdef DENSE_KERNELS_X86
+
+        __attribute__((target("sse4.2")))
+        void replace_sse42(int * rep, int length, int u, int v) {
+            const __m128i u_vec = _mm_set1_epi32(u);
+            const __m128i v_vec = _mm_set1_epi32(v);
+
+            int i = 0;
+            for (; i+4 <= length; i+=4) {
+                __m128i cur = _mm_loadu_si128((const __m128i *) (rep + i));
+                __m128i comparison = _mm_cmpeq_epi32(cur, u_vec);
+                _mm_storeu_si128((__m128i *) (rep + i), _mm_blendv_epi8(cur, v_vec, comparison));
+            }
+            replace_scalar(rep + i, length - i, u, v);
+        }
+
+        __attribute__((target("sse4.2")))
+        int32_t add_row_sse42(const int32_t * src, int32_t * dest, const int * rep, int label, int n) {
+            const __m128i label_vec = _mm_set1_epi32(label);
+            __m128i total = _mm_setzero_si128();
+
+            int k = 0;
+            for (; k+4 <= n; k+=4) {
+                __m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (src + k)), _mm_loadu_si128((const __m128i *) (dest + k)));
+                __m128i loop = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (rep + k)), label_vec);
+                sum = _mm_andnot_si128(loop, sum);
+                _mm_storeu_si128((__m128i *) (dest + k), sum);
+                total = _mm_add_epi32(total, sum);
+            }
+            total = _mm_add_epi32(total, _mm_unpackhi_epi64(total, total));
+            total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 1));
+            return _mm_cvtsi128_si32(total) + add_row_scalar(src + k, dest + k, rep + k, label, n - k);
+        }
+
+        __attribute__((target("sse4.2")))
+        int64_t add_row_sse42(const int64_t * src, int64_t * dest, const int * rep, int label, int n) {
+            const __m128i label_vec = _mm_set1_epi32(label);
+            __m128i total = _mm_setzero_si128();
+
+            int k = 0;
+            for (; k+2 <= n; k+=2) {
+                __m128i sum = _mm_add_epi64(_mm_loadu_si128((const __m128i *) (src + k)), _mm_loadu_si128((const __m128i *) (dest + k)));
+                //widen the comparison of two labels to two 64 bit masks
+                __m128i loop = _mm_cvtepi32_epi64(_mm_cmpeq_epi32(_mm_loadl_epi64((const __m128i *) (rep + k)), label_vec));
+                sum = _mm_andnot_si128(loop, sum);
+                _mm_storeu_si128((__m128i *) (dest + k), sum);
+                total = _mm_add_epi64(total, sum);
+            }
+            total = _mm_add_epi64(total, _mm_unpackhi_epi64(total, total));
+            return _mm_cvtsi128_si64(total) + add_row_scalar(src + k, dest + k, rep + k, label, n - k);
+        }
+
+        //There is no gather before AVX2, the vectors are assembled from scalar loads. The non-temporal stores need aligned
+        //addresses, the elements before the first aligned one are stored normally
+
+        __attribute__((target("sse4.2")))
+        void gather_row_sse42(const int32_t * row, const int * columns, int n, int32_t * out, bool streaming) {
+            int k = 0;
+            if (streaming) {
+                for (; k<n && ((uintptr_t) (out + k)) % sizeof(__m128i) != 0; k++) {
+                    out[k] = row[columns[k]];
+                }
+            }
+            for (; k+4 <= n; k+=4) {
+                __m128i values = _mm_set_epi32(row[columns[k+3]], row[columns[k+2]], row[columns[k+1]], row[columns[k]]);
+                if (streaming) {
+                    _mm_stream_si128((__m128i *) (out + k), values);
+                } else {
+                    _mm_storeu_si128((__m128i *) (out + k), values);
+                }
+            }
+            gather_row_scalar(row, columns + k, n - k, out + k, false);
+        }
+
+        __attribute__((target("sse4.2")))
+        void gather_row_sse42(const int64_t * row, const int * columns, int n, int64_t * out, bool streaming) {
+            int k = 0;
+            if (streaming) {
+                for (; k<n && ((uintptr_t) (out + k)) % sizeof(__m128i) != 0; k++) {
+                    out[k] = row[columns[k]];
+                }
+            }
+            for (; k+2 <= n; k+=2) {
+                __m128i values = _mm_set_epi64x(row[columns[k+1]], row[columns[k]]);
+                if (streaming) {
+                    _mm_stream_si128((__m128i *) (out + k), values);
+                } else {
+                    _mm_storeu_si128((__m128i *) (out + k), values);
+                }
+            }
+            gather_row_scalar(row, columns + k, n - k, out + k, false);
+        }
+
+        //unrolled twice, the loop is bound by the stores
+        __attribute__((target("avx2")))
+        void replace_avx2(int * rep, int length, int u, int v) {
+            const int elements_per_vector = 8;
+            const __m256i u_vec = _mm256_set1_epi32(u);
+            const __m256i v_vec = _mm256_set1_epi32(v);
+
+            int i = 0;
+            for (; i+2*elements_per_vector <= length; i+=2*elements_per_vector) {
+                __m256i cur1 = _mm256_loadu_si256((const __m256i *) (rep + i));
+                __m256i cur2 = _mm256_loadu_si256((const __m256i *) (rep + i + elements_per_vector));
+
+                __m256i comparison1 = _mm256_cmpeq_epi32(cur1, u_vec);
+                __m256i comparison2 = _mm256_cmpeq_epi32(cur2, u_vec);
+
+                _mm256_storeu_si256((__m256i *) (rep + i), _mm256_blendv_epi8(cur1, v_vec, comparison1));
+                _mm256_storeu_si256((__m256i *) (rep + i + elements_per_vector), _mm256_blendv_epi8(cur2, v_vec, comparison2));
+            }
+            replace_scalar(rep + i, length - i, u, v);
+        }
+
+        __attribute__((target("avx2")))
+        int32_t add_row_avx2(const int32_t * src, int32_t * dest, const int * rep, int label, int n) {
+            const __m256i label_vec = _mm256_set1_epi32(label);
+            __m256i total = _mm256_setzero_si256();
+
+            int k = 0;
+            for (; k+8 <= n; k+=8) {
+                __m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (src + k)), _mm256_loadu_si256((const __m256i *) (dest + k)));
+                __m256i loop = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (rep + k)), label_vec);
+                sum = _mm256_andnot_si256(loop, sum);
+                _mm256_storeu_si256((__m256i *) (dest + k), sum);
+                total = _mm256_add_epi32(total, sum);
+            }
+            __m128i half = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+            half = _mm_add_epi32(half, _mm_unpackhi_epi64(half, half));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 1));
+            return _mm_cvtsi128_si32(half) + add_row_scalar(src + k, dest + k, rep + k, label, n - k);
+        }
+
+        __attribute__((target("avx2")))
+        int64_t add_row_avx2(const int64_t * src, int64_t * dest, const int * rep, int label, int n) {
+            const __m128i label_vec = _mm_set1_epi32(label);
+            __m256i total = _mm256_setzero_si256();
+
+            int k = 0;
+            for (; k+4 <= n; k+=4) {
+                __m256i sum = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *) (src + k)), _mm256_loadu_si256((const __m256i *) (dest + k)));
+                __m256i loop = _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (rep + k)), label_vec));
+                sum = _mm256_andnot_si256(loop, sum);
+                _mm256_storeu_si256((__m256i *) (dest + k), sum);
+                total = _mm256_add_epi64(total, sum);
+            }
+            __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+            return _mm_cvtsi128_si64(_mm_add_epi64(half, _mm_unpackhi_epi64(half, half))) + add_row_scalar(src + k, dest + k, rep + k, label, n - k);
+        }
+
+        //Every vector is gathered before it is stored, so the stores never overtake the loads of the in place compaction.
+        //The non-temporal stores need aligned addresses, the elements before the first aligned one are stored normally
+
+        __attribute__((target("avx2")))
+        void gather_row_avx2(const int32_t * row, const int * columns, int n, int32_t * out, bool streaming) {
+            int k = 0;
+            if (streaming) {
+                for (; k<n && ((uintptr_t) (out + k)) % sizeof(__m256i) != 0; k++) {
+                    out[k] = row[columns[k]];
+                }
+            }
+            for (; k+8 <= n; k+=8) {
+                __m256i values = _mm256_i32gather_epi32(row, _mm256_loadu_si256((const __m256i *) (columns + k)), 4);
+                if (streaming) {
+                    _mm256_stream_si256((__m256i *) (out + k), values);
+                } else {
+                    _mm256_storeu_si256((__m256i *) (out + k), values);
+                }
+            }
+            gather_row_scalar(row, columns + k, n - k, out + k, false);
+        }
+
+        __attribute__((target("avx2")))
+        void gather_row_avx2(const int64_t * row, const int * columns, int n, int64_t * out, bool streaming) {
+            int k = 0;
+            if (streaming) {
+                for (; k<n && ((uintptr_t) (out + k)) % sizeof(__m256i) != 0; k++) {
+                    out[k] = row[columns[k]];
+                }
+            }
+            for (; k+4 <= n; k+=4) {
+                __m256i values = _mm256_i32gather_epi64((const long long *) row, _mm_loadu_si128((const __m128i *) (columns + k)), 8);
+                if (streaming) {
+                    _mm256_stream_si256((__m256i *) (out + k), values);
+                } else {
+                    _mm256_storeu_si256((__m256i *) (out + k), values);
+                }
+            }
+            gather_row_scalar(row, columns + k, n - k, out + k, false);
+        }
+
+        //The AVX-512 variants handle the tail with masked loads and stores instead of a scalar loop
+
+        __attribute__((target("avx512f")))
+        void replace_avx512(int * rep, int length, int u, int v) {
+            const __m512i u_vec = _mm512_set1_epi32(u);
+            const __m512i v_vec = _mm512_set1_epi32(v);
+
+            for (int i=0; i<length; i+=16) {
+                __mmask16 in_range = length - i >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << (length - i)) - 1);
+                __m512i cur = _mm512_maskz_loadu_epi32(in_range, rep + i);
+                //only the elements equal to u are written
+                _mm512_mask_storeu_epi32(rep + i, _mm512_mask_cmpeq_epi32_mask(in_range, cur, u_vec), v_vec);
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        int32_t add_row_avx512(const int32_t * src, int32_t * dest, const int * rep, int label, int n) {
+            const __m512i label_vec = _mm512_set1_epi32(label);
+            __m512i total = _mm512_setzero_si512();
+
+            for (int k=0; k<n; k+=16) {
+                __mmask16 in_range = n - k >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << (n - k)) - 1);
+                __m512i sum = _mm512_add_epi32(_mm512_maskz_loadu_epi32(in_range, src + k), _mm512_maskz_loadu_epi32(in_range, dest + k));
+                __mmask16 loop = _mm512_mask_cmpeq_epi32_mask(in_range, _mm512_maskz_loadu_epi32(in_range, rep + k), label_vec);
+                sum = _mm512_maskz_mov_epi32(_mm512_knot(loop), sum);
+                _mm512_mask_storeu_epi32(dest + k, in_range, sum);
+                total = _mm512_add_epi32(total, sum);
+            }
+            return _mm512_reduce_add_epi32(total);
+        }
+
+        __attribute__((target("avx512f")))
+        int64_t add_row_avx512(const int64_t * src, int64_t * dest, const int * rep, int label, int n) {
+            const __m512i label_vec = _mm512_set1_epi64(label);
+            __m512i total = _mm512_setzero_si512();
+
+            for (int k=0; k<n; k+=8) {
+                __mmask8 in_range = n - k >= 8 ? (__mmask8) 0xff : (__mmask8) ((1u << (n - k)) - 1);
+                __m512i sum = _mm512_add_epi64(_mm512_maskz_loadu_epi64(in_range, src + k), _mm512_maskz_loadu_epi64(in_range, dest + k));
+                __m512i labels = _mm512_cvtepi32_epi64(_mm512_castsi512_si256(_mm512_maskz_loadu_epi32((__mmask16) in_range, rep + k)));
+                __mmask8 loop = _mm512_mask_cmpeq_epi64_mask(in_range, labels, label_vec);
+                sum = _mm512_maskz_mov_epi64((__mmask8) (in_range & ~loop), sum);
+                _mm512_mask_storeu_epi64(dest + k, in_range, sum);
+                total = _mm512_add_epi64(total, sum);
+            }
+            return _mm512_reduce_add_epi64(total);
+        }
+
+        __attribute__((target("avx512f")))
+        void gather_row_avx512(const int32_t * row, const int * columns, int n, int32_t * out, bool streaming) {
+            int k = 0;
+            if (streaming) {
+                for (; k<n && ((uintptr_t) (out + k)) % sizeof(__m512i) != 0; k++) {
+                    out[k] = row[columns[k]];
+                }
+            }
+            for (; k<n; k+=16) {
+                __mmask16 in_range = n - k >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << (n - k)) - 1);
+                __m512i indices = _mm512_maskz_loadu_epi32(in_range, columns + k);
+                __m512i values = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), in_range, indices, row, 4);
+                if (streaming && in_range == 0xffff) {
+                    _mm512_stream_si512((__m512i *) (out + k), values);
+                } else {
+                    _mm512_mask_storeu_epi32(out + k, in_range, values);
+                }
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void gather_row_avx512(const int64_t * row, const int * columns, int n, int64_t * out, bool streaming) {
+            int k = 0;
+            if (streaming) {
+                for (; k<n && ((uintptr_t) (out + k)) % sizeof(__m512i) != 0; k++) {
+                    out[k] = row[columns[k]];
+                }
+            }
+            for (; k<n; k+=8) {
+                __mmask8 in_range = n - k >= 8 ? (__mmask8) 0xff : (__mmask8) ((1u << (n - k)) - 1);
+                __m256i indices = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32((__mmask16) in_range, columns + k));
+                __m512i values = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), in_range, indices, row, 8);
+                if (streaming && in_range == 0xff) {
+                    _mm512_stream_si512((__m512i *) (out + k), values);
+                } else {
+                    _mm512_mask_storeu_epi64(out + k, in_range, values);
+                }
+            }
+        }
+
+#endif
+
+        instruction_set_t detect_instruction_set() {
+#ifdef DENSE_KERNELS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) return AVX512;
+            if (__builtin_cpu_supports("avx2")) return AVX2;
+            if (__builtin_cpu_supports("sse4.2")) return SSE42;
+#endif
+            return SCALAR;
+        }
+
+    }
+
+    instruction_set_t detected_instruction_set() {
+        static const instruction_set_t detected = detect_instruction_set();
+        return detected;
+    }
+
+    bool is_supported(instruction_set_t set) {
+        return set <= detected_instruction_set();
+    }
+
+    const char * instruction_set_name(instruction_set_t set) {
+        switch (set) {
+            case AVX512: return "avx512";
+            case AVX2: return "avx2";
+            case SSE42: return "sse4.2";
+            default: return "scalar";
+        }
+    }
+
+    replace_t select_replace(instruction_set_t set) {
+        switch (set) {
+#ifdef DENSE_KERNELS_X86
+            case AVX512: return &replace_avx512;
+            case AVX2: return &replace_avx2;
+            case SSE42: return &replace_sse42;
+#endif
+            default: return &replace_scalar;
+        }
+    }
+
+    template <typename T>
+    add_row_t<T> select_add_row(instruction_set_t set) {
+        switch (set) {
+#ifdef DENSE_KERNELS_X86
+            case AVX512: return static_cast<add_row_t<T>>(&add_row_avx512);
+            case AVX2: return static_cast<add_row_t<T>>(&add_row_avx2);
+            case SSE42: return static_cast<add_row_t<T>>(&add_row_sse42);
+#endif
+            default: return &add_row_scalar<T>;
+        }
+    }
+
+    template add_row_t<int32_t> select_add_row<int32_t>(instruction_set_t set);
+    template add_row_t<int64_t> select_add_row<int64_t>(instruction_set_t set);
+
+    template <typename T>
+    gather_row_t<T> select_gather_row(instruction_set_t set) {
+        switch (set) {
+#ifdef DENSE_KERNELS_X86
+            case AVX512: return static_cast<gather_row_t<T>>(&gather_row_avx512);
+            case AVX2: return static_cast<gather_row_t<T>>(&gather_row_avx2);
+            case SSE42: return static_cast<gather_row_t<T>>(&gather_row_sse42);
+#endif
+            default: return &gather_row_scalar<T>;
+        }
+    }
+
+    template gather_row_t<int32_t> select_gather_row<int32_t>(instruction_set_t set);
+    template gather_row_t<int64_t> select_gather_row<int64_t>(instruction_set_t set);
+
+    void store_fence() {
+#ifdef DENSE_KERNELS_X86
+        _mm_sfence();
+#endif
+    }
+
+    void replace(int * rep, int length, int u, int v) {
+        static const replace_t kernel = select_replace(detected_instruction_set());
+        kernel(rep, length, u, v);
+    }
+
+    int32_t add_row_remove_loops_32(const int32_t * src, int32_t * dest, const int * rep, int label, int n) {
+        static const add_row_t<int32_t> kernel = select_add_row<int32_t>(detected_instruction_set());
+        return kernel(src, dest, rep, label, n);
+    }
+
+    int64_t add_row_remove_loops_64(const int64_t * src, int64_t * dest, const int * rep, int label, int n) {
+        static const add_row_t<int64_t> kernel = select_add_row<int64_t>(detected_instruction_set());
+        return kernel(src, dest, rep, label, n);
+    }
+
+    void gather_row_32(const int32_t * row, const int * columns, int n, int32_t * out, bool streaming) {
+        static const gather_row_t<int32_t> kernel = select_gather_row<int32_t>(detected_instruction_set());
+        kernel(row, columns, n, out, streaming);
+    }
+
+    void gather_row_64(const int64_t * row, const int * columns, int n, int64_t * out, bool streaming) {
+        static const gather_row_t<int64_t> kernel = select_gather_row<int64_t>(detected_instruction_set());
+        kernel(row, columns, n, out, streaming);
+    }
+
+}
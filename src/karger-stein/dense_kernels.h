@@ -0,0 +1,96 @@
+//
+//  dense_kernels.h
+//
+//  The row kernels of the dense base case (bulk union, the row addition of an edge contraction and the compaction).
+//  Every kernel has a scalar, an SSE4.2, an AVX2 and an AVX-512 variant, which are compiled with target attributes,
+//  so one binary built without -march=native runs everywhere. The fastest variant the CPU supports is picked once at runtime.
+//
+
+#ifndef _dense_kernels_h
+#define _dense_kernels_h
+
+#include <stdint.h>
+#include <type_traits>
+
+namespace dense_kernels {
+
+    enum instruction_set_t { SCALAR, SSE42, AVX2, AVX512 };
+
+    //The best instruction set of the CPU we are running on, detected once. The combine kernels of the dense
+    //contraction are selected by it as well
+    instruction_set_t detected_instruction_set();
+
+    bool is_supported(instruction_set_t set);
+
+    const char * instruction_set_name(instruction_set_t set);
+
+    //rep[k] = v for every k in [0, length) with rep[k] == u
+    typedef void (*replace_t)(int * rep, int length, int u, int v);
+
+    //dest[k] = rep[k] == label ? 0 : dest[k] + src[k] for every k in [0, n), returns the sum of the new dest
+    template <typename T>
+    using add_row_t = T (*)(const T * src, T * dest, const int * rep, int label, int n);
+
+    //out[k] = row[columns[k]] for every k in [0, n). out may overlap row if out + k <= row + columns[k] for every k,
+    //the compaction uses this to gather the rows in place. With streaming, out is written with non-temporal stores
+    //and store_fence has to be called before it is read by another thread
+    template <typename T>
+    using gather_row_t = void (*)(const T * row, const int * columns, int n, T * out, bool streaming);
+
+    //Matrices larger than this are evicted from the cache before the contractions read them again,
+    //so the compaction writes them with non-temporal stores
+    const long streaming_store_bytes = 4l << 20;
+
+    void store_fence();
+
+    //The variants for a given (supported) instruction set, for the benchmarks
+    replace_t select_replace(instruction_set_t set);
+
+    //Defined for int32_t and int64_t
+    template <typename T>
+    add_row_t<T> select_add_row(instruction_set_t set);
+
+    template <typename T>
+    gather_row_t<T> select_gather_row(instruction_set_t set);
+
+    //The variants for the detected instruction set
+    void replace(int * rep, int length, int u, int v);
+    int32_t add_row_remove_loops_32(const int32_t * src, int32_t * dest, const int * rep, int label, int n);
+    int64_t add_row_remove_loops_64(const int64_t * src, int64_t * dest, const int * rep, int label, int n);
+    void gather_row_32(const int32_t * row, const int * columns, int n, int32_t * out, bool streaming);
+    void gather_row_64(const int64_t * row, const int * columns, int n, int64_t * out, bool streaming);
+
+    //Integer weights wrap around the same way whether they are signed or not, so they use the kernel of their width
+    template <typename T>
+    T add_row_remove_loops(const T * src, T * dest, const int * rep, int label, int n) {
+        if (std::is_integral<T>::value && sizeof(T) == sizeof(int32_t)) {
+            return (T) add_row_remove_loops_32((const int32_t *) src, (int32_t *) dest, rep, label, n);
+        } else if (std::is_integral<T>::value && sizeof(T) == sizeof(int64_t)) {
+            return (T) add_row_remove_loops_64((const int64_t *) src, (int64_t *) dest, rep, label, n);
+        } else {
+            T sum = (T)0;
+            for (int k=0; k<n; k++) {
+                dest[k] = rep[k] == label ? (T)0 : dest[k] + src[k];
+                sum += dest[k];
+            }
+            return sum;
+        }
+    }
+
+    //Gathering only moves the bits, so any weight type uses the kernel of its width
+    template <typename T>
+    void gather_row(const T * row, const int * columns, int n, T * out, bool streaming) {
+        if (sizeof(T) == sizeof(int32_t)) {
+            gather_row_32((const int32_t *) row, columns, n, (int32_t *) out, streaming);
+        } else if (sizeof(T) == sizeof(int64_t)) {
+            gather_row_64((const int64_t *) row, columns, n, (int64_t *) out, streaming);
+        } else {
+            for (int k=0; k<n; k++) {
+                out[k] = row[columns[k]];
+            }
+        }
+    }
+
+}
+
+#endif
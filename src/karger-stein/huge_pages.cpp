@@ -0,0 +1,72 @@
+//
+//  huge_pages.cpp
+//
+
+#include "huge_pages.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+//MAP_HUGETLB alone maps pages of the default huge page size (e.g. 1 GB), which the mapping is not rounded to,
+//so the pages are requested with the size of page_size
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+#define HUGE_PAGE_FLAGS (MAP_HUGETLB | (21 << MAP_HUGE_SHIFT))
+#endif
+
+namespace huge_pages {
+
+    block allocate(size_t bytes, backing backing) {
+        block result;
+
+        if (backing != HEAP && bytes >= page_size) {
+            size_t mapped_size = (bytes + page_size - 1) / page_size * page_size;
+            void * pages = MAP_FAILED;
+
+            #ifdef HUGE_PAGE_FLAGS
+            if (backing == RESERVED) {
+                pages = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | HUGE_PAGE_FLAGS, -1, 0);
+            }
+            #endif
+
+            if (pages == MAP_FAILED) {
+                //map one huge page more and unmap the ends, so that the block starts at a huge page boundary
+                char * region = (char *) mmap(NULL, mapped_size + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+                if (region != MAP_FAILED) {
+                    char * aligned = (char *) (((uintptr_t) region + page_size - 1) & ~(uintptr_t) (page_size - 1));
+                    if (aligned > region) {
+                        munmap(region, aligned - region);
+                    }
+                    munmap(aligned + mapped_size, region + page_size - aligned);
+                    pages = aligned;
+
+                    #ifdef MADV_HUGEPAGE
+                    madvise(pages, mapped_size, MADV_HUGEPAGE);//only a hint, failure is fine
+                    #endif
+                }
+            }
+
+            if (pages != MAP_FAILED) {
+                result.memory = pages;
+                result.bytes = mapped_size;
+                result.mapped = true;
+                return result;
+            }
+        }
+
+        result.memory = malloc(bytes);
+        result.bytes = result.memory ? bytes : 0;
+        return result;
+    }
+
+    void release(block & block) {
+        if (block.mapped) {
+            munmap(block.memory, block.bytes);
+        } else {
+            free(block.memory);
+        }
+        block = huge_pages::block();
+    }
+
+}
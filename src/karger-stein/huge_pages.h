@@ -0,0 +1,37 @@
+//
+//  huge_pages.h
+//
+//  Large buffers backed by huge pages, for the stack allocator of the base case and the workspace of the dense recursion.
+//  A block remembers how it was allocated, so release frees it the same way.
+//
+
+#ifndef _huge_pages_h
+#define _huge_pages_h
+
+#include <stddef.h>
+
+namespace huge_pages {
+
+    //HEAP: malloc
+    //TRANSPARENT: mapped at a huge page boundary, rounded to whole huge pages and advised to use transparent huge pages
+    //RESERVED: mapped from the reserved 2 MB huge pages (MAP_HUGETLB), or as above if there are not enough
+    enum backing { HEAP, TRANSPARENT, RESERVED };
+
+    //The size the mappings are aligned at and rounded to. Smaller blocks come from malloc, a mapping would waste most of its page
+    const size_t page_size = 2l << 20;
+
+    struct block {
+        void * memory = nullptr;
+        size_t bytes = 0;//at least the requested number of bytes
+        bool mapped = false;
+    };
+
+    //Falls back to malloc if the mapping fails, memory is null if malloc fails as well
+    block allocate(size_t bytes, backing backing);
+
+    //Resets the block
+    void release(block & block);
+
+}
+
+#endif
@@ -137,9 +137,7 @@ int indexed_adjacency_matrix<T>::select(array<T> capacities) {//select the first
 template <class T>
 T indexed_adjacency_matrix<T>::contract_edge(int i, int j) {
     
-    matrix.contract_edge(i, j);
-
-    T new_capacity = matrix.sum_row(j);
+    T new_capacity = matrix.contract_edge(i, j);
     
     T contracted_weight = (capacities[j]+capacities[i]-new_capacity)/2;
     capacities_sum_tree.update(j, new_capacity);
@@ -170,7 +168,7 @@ T indexed_adjacency_matrix<T>::contract_random_edge(sitmo::prng_engine * random_
     return contracted_weight;
 }
 
-//precondition: aux_storage needs to be able to hold union_find.number_of_sets * vertex_count element of type T and vertex_count elements of type int
+//precondition: aux_storage needs to be able to hold 2 * vertex_count elements of type int
 template <class T>
 void indexed_adjacency_matrix<T>::compact(stack_allocator * aux_storage) {
     
@@ -10,6 +10,7 @@
 #define _lazy_adjacency_matrix_hpp
 
 #include "bulk_union_find.h"
+#include "dense_kernels.h"
 #include "adjacency_matrix.hpp"
 #include "algorithm"
 #include "matrices.hpp"
@@ -21,9 +22,6 @@ class lazy_adjacency_matrix {
     
     bulk_union_find union_find;
     
-    void rank(array<int> source, array<int> destination);
-    void sum_rows(T * src, T * dest, int n);
-    void clean_rows();
 public:
     
     lazy_adjacency_matrix(int number_of_vertices, stack_allocator * storage) :
@@ -52,7 +50,8 @@ public:
                 
     int rep(int i) const;
     
-    void contract_edge(int i, int j);
+    //returns the new capacity of j
+    T contract_edge(int i, int j);
     
     void compact(stack_allocator * aux_storage);
     
@@ -117,7 +116,7 @@ T lazy_adjacency_matrix<T>::sum_row(int j) const {
 
 
 template <class T>
-void lazy_adjacency_matrix<T>::contract_edge(int i, int j) {
+T lazy_adjacency_matrix<T>::contract_edge(int i, int j) {
     assert(i != j);
     
     //perform bulk union
@@ -134,79 +133,55 @@ void lazy_adjacency_matrix<T>::contract_edge(int i, int j) {
     
     //std::cout << "proceed to add rows (" << vertices << ") vertices" << std::endl;
     
-    //#pragma omp parallel for
-    for (int k=0; k<vertices; k++) {
-        
-        //add row i to row j
-        row_j[k] += row_i[k];
-        //remove loops
-        if (union_find.rep[k] == j) {
-            row_j[k] = (T)0;
-        }
-        //this is actually not necessary
-        //zero out row i
-        //row_i[k] = (T)0;
-    }
-    
-    //std::cout << "done with contracting" << std::endl;
-    
+    //add row i to row j and remove loops (row i does not need to be zeroed out)
+    return dense_kernels::add_row_remove_loops(row_i, row_j, union_find.rep.begin(), j, vertices);
 }
 
 
-//precondition: aux_storage needs to be able to hold union_find.number_of_sets * vertex_count element of type T and vertex_count elements of type int
+//The rows of the representatives are compacted in place, in increasing order: the columns of the other vertices are
+//added to the column of their representative, then the columns of the representatives are gathered to the front.
+//The compacted row r starts at or before row r of the representatives and ends before the next one, so no row is overwritten before it is read.
+//precondition: aux_storage needs to be able to hold 2 * vertex_count elements of type int
 template <class T>
 void lazy_adjacency_matrix<T>::compact(stack_allocator * aux_storage) {
-    //the element matrix (at element_storage) is of size vertex_count * vertex_count
     stack_state saved_stack_state = aux_storage->enter();
     
-    long original_capacity = adjacencies.vertex_count;
-    long target_capacity = union_find.number_of_sets;
-    
-    //remove invalid rows
-    clean_rows();
-    //the element matrix is now of size target_capacity * vertex_count
-    
-    //this will give the correspondance between the columns (= between the rows of the transpose)
-    array<int> correspondence = aux_storage->allocate<int>(original_capacity);
-    
-    //transpose
-    //the aux_matrix is of size vertex_count * target_capacity, as it is the transpose of the row-cleaned element matrix
-    
-    array<T> aux_matrix = aux_storage->allocate<T>(target_capacity*original_capacity);
-    matrices::transpose<T>(adjacencies.get_row(0), aux_matrix.begin(), target_capacity, original_capacity);
-    
-    //the ranks of the representatives define the correspondance between the rows of the aux_matrix
-    rank(union_find.rep, correspondence);
-    
-    //now we extend the ranks, such that indices contain the rank of their representative. This allows us to discard the rep array
-    for (int i=0; i<original_capacity; i++) {
-        correspondence.set(i, correspondence[union_find.rep[i]]);
+    int original_capacity = adjacencies.vertex_count;
+    int target_capacity = union_find.number_of_sets;
+    int merged = original_capacity - target_capacity;
+    
+    //the representatives, in increasing order, and the other vertices together with their representatives
+    array<int> representatives = aux_storage->allocate<int>(target_capacity);
+    array<int> others = aux_storage->allocate<int>(merged);
+    array<int> others_rep = aux_storage->allocate<int>(merged);
+    
+    for (int i=0, r=0, o=0; i<original_capacity; i++) {
+        if (union_find.rep[i] == i) {
+            representatives.set(r++, i);
+        } else {
+            others.set(o, i);
+            others_rep.set(o++, union_find.rep[i]);
+        }
     }
     
-    //combine rows of transpose
-    //the destination matrix is of size target_capacity * target_capacity
-    
-    adjacencies.set_elements(target_capacity, adjacencies.get_elements().prefix((long)target_capacity*target_capacity));
+    bool streaming = (long) target_capacity*target_capacity*sizeof(T) >= dense_kernels::streaming_store_bytes;
     
-    //sum together corresponding rows
-    array<bool> initialized = aux_storage->allocate<bool>(target_capacity);
-    std::fill<bool*>(initialized.begin(), initialized.end(), false);
-    
-    for (long i=0; i<original_capacity; ++i) {
-        T * src_row = aux_matrix.address(i*target_capacity);
-        int dest_i = correspondence[i];
-        
-        T * dest_row = adjacencies.get_row(dest_i);
+    T * elements = adjacencies.get_row(0);
+    for (int r=0; r<target_capacity; ++r) {
+        T * row = elements + (long) representatives[r]*original_capacity;
         
-        if (initialized[dest_i]) {//not the first row
-            sum_rows(src_row, dest_row, target_capacity);
-        } else {//the first row
-            std::copy(src_row, src_row+target_capacity, dest_row);
-            initialized.set(dest_i, true);
+        for (int k=0; k<merged; ++k) {
+            row[others_rep[k]] += row[others[k]];
         }
         
+        dense_kernels::gather_row(row, representatives.begin(), target_capacity, elements + (long) r*target_capacity, streaming);
+    }
+    
+    if (streaming) {
+        dense_kernels::store_fence();
     }
-    //the element matrix is now of size target_capacity * target_capacity
+    
+    adjacencies.set_elements(target_capacity, adjacencies.get_elements().prefix((long)target_capacity*target_capacity));
     
     //reinitialize smaller union find structure
     union_find.compact();
@@ -215,37 +190,4 @@ void lazy_adjacency_matrix<T>::compact(stack_allocator * aux_storage) {
     aux_storage->leave(saved_stack_state);
 }
 
-//postcondition: destination[i] contains the rank of i in 'source' if i appears in source and an arbitrary value otherwise
-template <class T>
-void lazy_adjacency_matrix<T>::rank(array<int> source, array<int> destination) {
-    
-    
-    int n = source.get_length();
-    //mark all values that appear with a 1
-    std::fill<int*>(destination.begin(), destination.end(), 0);
-    for (int i=0; i<n; i++) {
-        destination.set(source[i], 1);
-    }
-    //the partial sums almost give the rank (1 based so we need to subtract 1 to get 0-based ranks)
-    destination.set(0, destination[0]-1);
-    std::partial_sum<int*>(destination.begin(), destination.end(), destination.begin());
-    
-}
-
-template <class T>
-void lazy_adjacency_matrix<T>::sum_rows(T * src, T * dest, int n) {
-    std::transform<T*>(src, src+n, dest, dest, std::plus<T>());
-}
-
-template <class T>
-void lazy_adjacency_matrix<T>::clean_rows() {
-    T * cur_dest = adjacencies.get_row(0);
-    int vertices = adjacencies.vertex_count;
-    for (int i=0; i<vertices; i++) {
-        if (union_find.rep[i] == i) {//valid row
-            cur_dest = std::copy<T*>(adjacencies.get_row(i), adjacencies.get_row(i+1), cur_dest);
-        }
-    }
-}
-
 #endif
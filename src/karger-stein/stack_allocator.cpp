@@ -9,6 +9,11 @@
 #include "stack_allocator.h"
 
 #include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+
+std::atomic<int> stack_allocator::backing(huge_pages::HEAP);
+std::atomic<long> stack_allocator::total_peak(0);
 
 
 ////
@@ -18,7 +23,7 @@
 
 stack_allocator::stack_allocator(long size) {
     //create first stack node
-    stack_allocator_node * node = new stack_allocator_node(size);
+    stack_allocator_node * node = new stack_allocator_node(size, get_page_backing());
     
     current_node = 0;
     nodes.push_back(node);
@@ -51,12 +56,50 @@ void stack_allocator::leave(stack_state state) {
     
     nodes[current_node]->leave(state.state);
     
+    used_below = 0;
+    for (unsigned int i=0; i<current_node; ++i) {
+        used_below += nodes[i]->head;
+    }
 }
 
 void stack_allocator::reserve(long size) {
+    long peak_before = peak;
     stack_state save = enter();
-    allocate<char>(size);
+    array<char> reserved = allocate<char>(size);
+    
+    //first touch: the pages are placed on the memory of the calling thread now, instead of the first thread which writes to them
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (long i=0; i<size; i+=page_size) {
+        reserved[i] = 0;
+    }
+    
     leave(save);
+    
+    //reserved bytes are not used yet
+    total_peak -= peak - peak_before;
+    peak = peak_before;
+}
+
+void stack_allocator::update_peak() {
+    long used = used_below + nodes[current_node]->head;
+    total_peak += used - peak;
+    peak = used;
+}
+
+long stack_allocator::peak_usage() const {
+    return peak;
+}
+
+void stack_allocator::set_page_backing(page_backing backing) {
+    stack_allocator::backing = backing;
+}
+
+stack_allocator::page_backing stack_allocator::get_page_backing() {
+    return (page_backing) backing.load();
+}
+
+long stack_allocator::total_peak_usage() {
+    return total_peak.load();
 }
 
 
@@ -65,18 +108,16 @@ void stack_allocator::reserve(long size) {
 ////
 
 
-stack_allocator_node::stack_allocator_node(long size) {
-    stack = (char*)malloc(size);
-    if (stack == NULL) {
-        capacity = 0;
-    } else {
-        capacity = size;
-    }
+stack_allocator_node::stack_allocator_node(long size, stack_allocator::page_backing backing) {
+    
+    pages = huge_pages::allocate(size, backing);
+    stack = (char*)pages.memory;
+    capacity = pages.bytes;
 }
 
 stack_allocator_node::~stack_allocator_node() {
     if (stack) {
-        free(stack);
+        huge_pages::release(pages);
         stack = NULL;
         head = 0;
         capacity = 0;
@@ -8,6 +8,8 @@
 //  This file provides a dynamically growing stack which can be used to allocate arrays of arbitrary type.
 //  This is useful to pass dynamically sized datastructures using a stack. This improves the spatial locality of those structures and prevents excessive fragmentation.
 //  The arrays returned by the allocator provide check for out of bounds errors when assertions are enabled.
+//  Large stack nodes can be mapped with (transparent) huge pages, see stack_allocator::set_page_backing. The pages are
+//  placed on the NUMA node of the thread which touches them first, which is the owner of the stack if it reserves them.
 
 #ifndef ____stack_allocator__
 #define ____stack_allocator__
@@ -22,6 +24,8 @@
 #include <stdlib.h>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include "huge_pages.h"
 
 
 class stack_allocator_node;
@@ -165,12 +169,27 @@ private:
 
 class stack_allocator {
     
+public:
+    
+    //Nodes of at least a huge page are allocated with the backing, see huge_pages::backing
+    typedef huge_pages::backing page_backing;
+    
+private:
+    
     std::vector<stack_allocator_node*> nodes;
     unsigned int current_node = 0;
     
+    long used_below = 0;//bytes used in the nodes before the current node
+    long peak = 0;
+    
+    static std::atomic<int> backing;
+    static std::atomic<long> total_peak;
+    
     template <typename T>
     void get_new_node(long size);
     
+    void update_peak();
+    
 public:
     
     stack_allocator(long size);
@@ -183,7 +202,17 @@ public:
     
     void leave(stack_state state);//restore the stack to the saved state
     
-    void reserve(long size);//prealloactes the given number of bytes. This makes sense if an asymptotic estimate of the required size is known
+    void reserve(long size);//prealloactes the given number of bytes and touches their pages on the calling thread. This makes sense if an asymptotic estimate of the required size is known
+    
+    long peak_usage() const;//the largest number of bytes allocated at the same time
+    
+    //Applies to the nodes allocated afterwards, by any stack allocator
+    static void set_page_backing(page_backing backing);
+    
+    static page_backing get_page_backing();
+    
+    //The sum of the peak usages of all stack allocators of the process
+    static long total_peak_usage();
     
 };
 
@@ -201,6 +230,7 @@ class stack_allocator_node {
     char * stack = NULL;
     long capacity = 0;//the length of the stack in char
     long head = 0;//the first free element is at stack+head
+    huge_pages::block pages;//holds stack
     bool invariant();
     
     long remaining() {//if remaining() > 0, then remaining() bytes are available. Otherwise no bytes are available.
@@ -209,7 +239,7 @@ class stack_allocator_node {
     
 public:
     
-    stack_allocator_node(long size);
+    stack_allocator_node(long size, stack_allocator::page_backing backing);
     ~stack_allocator_node();
     
     template <typename T>
@@ -244,7 +274,13 @@ array<T> stack_allocator::allocate(long size) {
         get_new_node<T>(size);
     }
     
-    return nodes[current_node]->allocate<T>(size);
+    array<T> result = nodes[current_node]->allocate<T>(size);
+    
+    if (used_below + nodes[current_node]->head > peak) {
+        update_peak();
+    }
+    
+    return result;
 }
 
 template <typename T>
@@ -256,11 +292,12 @@ void stack_allocator::get_new_node(long size) {
         if (nodes.size() <= current_node+1) {
             //std::cout << "c allocate new stack node " << std::endl;
             
-            stack_allocator_node * new_node = new stack_allocator_node(2 * std::max<long>(size*sizeof(T), nodes[current_node]->capacity));
+            stack_allocator_node * new_node = new stack_allocator_node(2 * std::max<long>(size*sizeof(T), nodes[current_node]->capacity), get_page_backing());
             if (new_node == NULL || new_node->stack == NULL) throw std::runtime_error("! stack_allocator: out of memory.\n");
             
             nodes.push_back(new_node);
         }
+        used_below += nodes[current_node]->head;
         ++current_node;
     }
     
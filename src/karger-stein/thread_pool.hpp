@@ -0,0 +1,252 @@
+//
+//  thread_pool.hpp
+//
+//  A fixed set of worker threads for the data parallel loops of the dense kernels and for the task parallel
+//  recursion of Karger-Stein. Every worker has a deque of tasks (the threads outside of the pool share one): it
+//  runs the newest task of its own deque first and steals the oldest task of another deque when its own is empty.
+//  A thread waiting for its tasks runs other tasks meanwhile, so waiting never blocks the pool and the
+//  loops and task groups can be nested. A pool of size 1 has no workers and runs everything inline.
+//  The threads never call MPI, so MPI programs using more than one thread need MPI_THREAD_FUNNELED.
+//
+
+#ifndef thread_pool_hpp
+#define thread_pool_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class task_group;
+
+class thread_pool {
+
+    friend class task_group;
+
+    struct task {
+        std::function<void()> body;
+        task_group * group;
+    };
+
+    struct task_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    std::vector<std::thread> workers;
+
+    //queues[0] is shared by the threads which are not workers of this pool, queues[i] belongs to worker i
+    std::vector<std::unique_ptr<task_queue>> queues;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<long> queued { 0 };
+    bool stopping = false;
+
+    struct worker_identity {
+        const thread_pool * pool;
+        int index;
+    };
+
+    static worker_identity & current_worker() {
+        static thread_local worker_identity identity = { nullptr, 0 };
+        return identity;
+    }
+
+    //The queue of the calling thread
+    int own_queue() const {
+        const worker_identity & identity = current_worker();
+        return identity.pool == this ? identity.index : 0;
+    }
+
+    void push(task && next) {
+        task_queue & queue = *queues[own_queue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(next));
+        }
+        ++queued;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        wake.notify_one();
+    }
+
+    bool pop(int index, task & result) {
+        if (queued.load() == 0) return false;
+
+        {
+            task_queue & queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                result = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                --queued;
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < queues.size(); ++i) {
+            task_queue & victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                result = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --queued;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //Runs one task, if there is any. Defined below task_group
+    bool run_one(int index);
+
+    void work(int index) {
+        current_worker() = { this, index };
+
+        while (true) {
+            if (run_one(index)) continue;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+            if (stopping) return;
+        }
+    }
+
+    static std::unique_ptr<thread_pool> & instance() {
+        static std::unique_ptr<thread_pool> pool(new thread_pool(1));
+        return pool;
+    }
+
+public:
+
+    //Starts threads - 1 workers
+    explicit thread_pool(int threads) {
+        for (int i = 0; i < std::max(threads, 1); ++i) {
+            queues.emplace_back(new task_queue());
+        }
+        for (int i = 1; i < threads; ++i) {
+            workers.emplace_back(&thread_pool::work, this, i);
+        }
+    }
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool & operator= (const thread_pool &) = delete;
+
+    //All task groups have to be waited for before
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto & worker : workers) worker.join();
+    }
+
+    //Number of threads running a loop, including the caller
+    int size() const { return (int) workers.size() + 1; }
+
+    //Runs body(0), ..., body(n - 1) in chunks of grain iterations and returns once all of them are done.
+    //May be called from within a task or a loop body.
+    void parallel_for(long n, const std::function<void(long)> & body, long grain = 1);
+
+    //The pool used by the contraction kernels and the Karger-Stein recursion. It has one thread unless set_global_threads is called
+    static thread_pool & global() { return *instance(); }
+
+    //Must not be called while the global pool runs a loop or a task
+    static void set_global_threads(int threads) {
+        if (threads != global().size()) instance().reset(new thread_pool(std::max(threads, 1)));
+    }
+
+};
+
+//A set of tasks run by a pool, which can be waited for. The tasks may run in any order and on any thread of the
+//pool, including the thread which calls wait.
+class task_group {
+
+    friend class thread_pool;
+
+    thread_pool & pool;
+    std::atomic<long> pending { 0 };
+
+public:
+
+    explicit task_group(thread_pool & pool = thread_pool::global()) : pool(pool) {}
+
+    task_group(const task_group &) = delete;
+    task_group & operator= (const task_group &) = delete;
+
+    ~task_group() { wait(); }
+
+    //Runs body inline if the pool has no workers
+    void run(std::function<void()> body) {
+        if (pool.size() == 1) {
+            body();
+            return;
+        }
+        ++pending;
+        pool.push(thread_pool::task { std::move(body), this });
+    }
+
+    //Returns once all tasks of the group are done, running tasks of the pool meanwhile
+    void wait() {
+        int index = pool.own_queue();
+        while (pending.load() > 0) {
+            if (pool.run_one(index)) continue;
+
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.wake.wait(lock, [&] { return pending.load() == 0 || pool.queued.load() > 0; });
+        }
+    }
+
+};
+
+inline bool thread_pool::run_one(int index) {
+    task next;
+    if (!pop(index, next)) return false;
+
+    next.body();
+
+    //the group may be destroyed as soon as a waiting thread sees that it has no pending tasks
+    if (--next.group->pending == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_all();
+    }
+    return true;
+}
+
+inline void thread_pool::parallel_for(long n, const std::function<void(long)> & body, long grain) {
+    if (workers.empty() || n <= grain) {
+        for (long i = 0; i < n; ++i) body(i);
+        return;
+    }
+
+    std::atomic<long> next { 0 };
+    auto run_chunks = [&] {
+        for (long first = next.fetch_add(grain); first < n; first = next.fetch_add(grain)) {
+            long last = std::min(first + grain, n);
+            for (long i = first; i < last; ++i) {
+                body(i);
+            }
+        }
+    };
+
+    //the chunks are handed out dynamically, so a helper which starts late just finds less work
+    long helpers = std::min<long>(size() - 1, (n + grain - 1) / grain - 1);
+
+    task_group group(*this);
+    for (long i = 0; i < helpers; ++i) {
+        group.run(run_chunks);
+    }
+    run_chunks();
+    group.wait();
+}
+
+#endif /* thread_pool_hpp */
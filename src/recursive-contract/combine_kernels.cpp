@@ -0,0 +1,191 @@
+//
+//  combine_kernels.cpp
+//
+//  The vector kernels are compiled for their instruction set with target attributes, so that the default build
+//  (without -march=native) still contains them. select_segmented_sums picks one at runtime, for the instruction set
+//  detected by dense_kernels.
+//
+
+#include <cassert>
+#include "combine_kernels.hpp"
+#include "dense_kernels.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define COMBINE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace combine_kernels {
+
+    column_runs group_columns(const int * relabeling, int columns, int labels) {
+        column_runs runs;
+        runs.order.resize(columns);
+        runs.run_offsets.assign(labels + 1, 0);
+
+        for (int c = 0; c < columns; ++c) {
+            assert (relabeling[c] >= 0 && relabeling[c] < labels);
+            runs.run_offsets[relabeling[c] + 1]++;
+        }
+
+        for (int l = 0; l < labels; ++l) {
+            runs.run_offsets[l + 1] += runs.run_offsets[l];
+        }
+
+        std::vector<int> position(runs.run_offsets.begin(), runs.run_offsets.end() - 1);
+        for (int c = 0; c < columns; ++c) {
+            runs.order[position[relabeling[c]]++] = c;
+        }
+
+        return runs;
+    }
+
+    namespace {
+
+        template <typename T>
+        void segmented_sums_scalar(const T * row, const column_runs & runs, int first_label, int last_label, T * out) {
+            const int * order = runs.order.data();
+            const int * offsets = runs.run_offsets.data();
+
+            for (int l = first_label; l < last_label; ++l) {
+                T sum = T();
+                for (int j = offsets[l]; j < offsets[l + 1]; ++j) {
+                    sum += row[order[j]];
+                }
+                out[l - first_label] = sum;
+            }
+        }
+
+#ifdef COMBINE_KERNELS_X86
+
+        //Runs shorter than a vector (most of them early in the recursion, where most labels are singletons) take the scalar tail only
+
+        __attribute__((target("avx2")))
+        void segmented_sums_avx2(const long * row, const column_runs & runs, int first_label, int last_label, long * out) {
+            const int * order = runs.order.data();
+            const int * offsets = runs.run_offsets.data();
+
+            for (int l = first_label; l < last_label; ++l) {
+                int j = offsets[l], end = offsets[l + 1];
+                long sum = 0;
+
+                if (end - j >= 4) {
+                    __m256i acc = _mm256_setzero_si256();
+                    for (; j + 4 <= end; j += 4) {
+                        __m128i index = _mm_loadu_si128((const __m128i *) (order + j));
+                        acc = _mm256_add_epi64(acc, _mm256_i32gather_epi64((const long long *) row, index, 8));
+                    }
+                    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+                    sum = _mm_cvtsi128_si64(_mm_add_epi64(half, _mm_unpackhi_epi64(half, half)));
+                }
+
+                for (; j < end; ++j) {
+                    sum += row[order[j]];
+                }
+                out[l - first_label] = sum;
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void segmented_sums_avx2(const int * row, const column_runs & runs, int first_label, int last_label, int * out) {
+            const int * order = runs.order.data();
+            const int * offsets = runs.run_offsets.data();
+
+            for (int l = first_label; l < last_label; ++l) {
+                int j = offsets[l], end = offsets[l + 1];
+                int sum = 0;
+
+                if (end - j >= 8) {
+                    __m256i acc = _mm256_setzero_si256();
+                    for (; j + 8 <= end; j += 8) {
+                        __m256i index = _mm256_loadu_si256((const __m256i *) (order + j));
+                        acc = _mm256_add_epi32(acc, _mm256_i32gather_epi32(row, index, 4));
+                    }
+                    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+                    half = _mm_add_epi32(half, _mm_unpackhi_epi64(half, half));
+                    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 1));
+                    sum = _mm_cvtsi128_si32(half);
+                }
+
+                for (; j < end; ++j) {
+                    sum += row[order[j]];
+                }
+                out[l - first_label] = sum;
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void segmented_sums_avx512(const long * row, const column_runs & runs, int first_label, int last_label, long * out) {
+            const int * order = runs.order.data();
+            const int * offsets = runs.run_offsets.data();
+
+            for (int l = first_label; l < last_label; ++l) {
+                int j = offsets[l], end = offsets[l + 1];
+                long sum = 0;
+
+                if (end - j >= 8) {
+                    __m512i acc = _mm512_setzero_si512();
+                    for (; j + 8 <= end; j += 8) {
+                        __m256i index = _mm256_loadu_si256((const __m256i *) (order + j));
+                        acc = _mm512_add_epi64(acc, _mm512_i32gather_epi64(index, row, 8));
+                    }
+                    sum = _mm512_reduce_add_epi64(acc);
+                }
+
+                for (; j < end; ++j) {
+                    sum += row[order[j]];
+                }
+                out[l - first_label] = sum;
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void segmented_sums_avx512(const int * row, const column_runs & runs, int first_label, int last_label, int * out) {
+            const int * order = runs.order.data();
+            const int * offsets = runs.run_offsets.data();
+
+            for (int l = first_label; l < last_label; ++l) {
+                int j = offsets[l], end = offsets[l + 1];
+                int sum = 0;
+
+                if (end - j >= 16) {
+                    __m512i acc = _mm512_setzero_si512();
+                    for (; j + 16 <= end; j += 16) {
+                        __m512i index = _mm512_loadu_si512((const void *) (order + j));
+                        acc = _mm512_add_epi32(acc, _mm512_i32gather_epi32(index, row, 4));
+                    }
+                    sum = _mm512_reduce_add_epi32(acc);
+                }
+
+                for (; j < end; ++j) {
+                    sum += row[order[j]];
+                }
+                out[l - first_label] = sum;
+            }
+        }
+
+#endif
+
+        //There is no SSE4.2 variant, the scalar one is used instead
+        template <typename T>
+        segmented_sums_t<T> select_for(dense_kernels::instruction_set_t set) {
+            switch (set) {
+#ifdef COMBINE_KERNELS_X86
+                case dense_kernels::AVX512: return static_cast<segmented_sums_t<T>>(&segmented_sums_avx512);
+                case dense_kernels::AVX2: return static_cast<segmented_sums_t<T>>(&segmented_sums_avx2);
+#endif
+                default: return &segmented_sums_scalar<T>;
+            }
+        }
+
+    }
+
+    template <typename T>
+    segmented_sums_t<T> select_segmented_sums() {
+        static const segmented_sums_t<T> kernel = select_for<T>(dense_kernels::detected_instruction_set());
+        return kernel;
+    }
+
+    template segmented_sums_t<int> select_segmented_sums<int>();
+    template segmented_sums_t<long> select_segmented_sums<long>();
+
+}
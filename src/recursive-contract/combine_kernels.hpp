@@ -0,0 +1,39 @@
+//
+//  combine_kernels.hpp
+//
+//  Kernels for combining the columns of dense slice rows as indicated by a relabeling.
+//  Instead of scatter-adding every column into its label, the columns are grouped by label once per contraction
+//  and each row is reduced with segmented sums, which vectorize (gathers) and do not have write conflicts.
+//
+
+#ifndef combine_kernels_hpp
+#define combine_kernels_hpp
+
+#include <vector>
+
+namespace combine_kernels {
+
+    //The columns labeled l are order[run_offsets[l]], ..., order[run_offsets[l + 1] - 1], in increasing order
+    struct column_runs {
+        std::vector<int> order;
+        std::vector<int> run_offsets;
+
+        int labels() const { return (int) run_offsets.size() - 1; }
+    };
+
+    //Counting sort of the columns [0, columns) by their label in [0, labels)
+    //Time: O(columns + labels)
+    column_runs group_columns(const int * relabeling, int columns, int labels);
+
+    //out[l - first_label] = sum of row[c] over the columns c labeled l, for every l in [first_label, last_label)
+    template <typename T>
+    using segmented_sums_t = void (*)(const T * row, const column_runs & runs, int first_label, int last_label, T * out);
+
+    //The fastest kernel the CPU we are running on supports (AVX-512, AVX2 or scalar), detected once
+    //Defined for int and long
+    template <typename T>
+    segmented_sums_t<T> select_segmented_sums();
+
+}
+
+#endif /* combine_kernels_hpp */
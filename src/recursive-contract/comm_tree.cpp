@@ -0,0 +1,36 @@
+//
+//  comm_tree.cpp
+//
+
+#include <cassert>
+#include "comm_tree.hpp"
+
+comm_tree::comm_tree(MPI_Comm comm) : groups(1, comm) {
+    int p, rank;
+    MPI_Comm_size(comm, &p);
+    MPI_Comm_rank(comm, &rank);
+
+    assert ((p & (p - 1)) == 0);
+
+    while (p > 1) {
+        MPI_Comm half, pair;
+        MPI_Comm_split(groups.back(), rank >= p/2, rank, &half);
+        MPI_Comm_split(groups.back(), rank % (p/2), rank, &pair);
+
+        groups.push_back(half);
+        pairs.push_back(pair);
+
+        p /= 2;
+        rank %= p;
+    }
+}
+
+comm_tree::~comm_tree() {
+    //An owner destroyed after MPI_Finalize has nothing left to free
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (finalized) return;
+
+    for (size_t d = 1; d < groups.size(); ++d) MPI_Comm_free(&groups[d]);
+    for (auto & pair : pairs) MPI_Comm_free(&pair);
+}
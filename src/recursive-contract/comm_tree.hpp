@@ -0,0 +1,48 @@
+//
+//  comm_tree.hpp
+//
+//  The communicators of the recursion in parallel_recursive_contract. Every level halves the group: the first half
+//  keeps the contracted graph and the second half receives a copy of it. The tree is built once per group
+//  (2 log p splits) and reused by all trials, instead of splitting the communicators at every level of every trial.
+//
+
+#ifndef comm_tree_hpp
+#define comm_tree_hpp
+
+#include <vector>
+#include "mpi.h"
+
+class comm_tree {
+
+    //groups[0] is the whole group (not owned), groups[d + 1] is the half of groups[d] containing this process
+    std::vector<MPI_Comm> groups;
+
+    //pairs[d] connects rank r < p/2 of groups[d] (rank 0 in the pair) with rank r + p/2 (rank 1 in the pair)
+    std::vector<MPI_Comm> pairs;
+
+public:
+
+    //Collective over comm, whose size must be a power of two
+    //Time: O(log p) communicator splits
+    explicit comm_tree(MPI_Comm comm);
+
+    ~comm_tree();
+
+    comm_tree(const comm_tree &) = delete;
+    comm_tree & operator= (const comm_tree &) = delete;
+
+    //Number of halvings until a single process is left, i.e. log2 of the group size
+    //Time: O(1)
+    int depth() const { return (int) pairs.size(); }
+
+    //The group at the given level, level 0 being the whole group
+    //Time: O(1)
+    MPI_Comm group(int level) const { return groups[level]; }
+
+    //The pair duplicating the graph when going from the given level to the next one
+    //Time: O(1)
+    MPI_Comm pair(int level) const { return pairs[level]; }
+
+};
+
+#endif /* comm_tree_hpp */
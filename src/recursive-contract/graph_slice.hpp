@@ -12,7 +12,11 @@
 #include <stdio.h>
 #include <random>
 #include <algorithm>
+#include <vector>
+#include <numeric>
 #include "sum_tree.hpp"
+#include "thread_pool.hpp"
+#include "combine_kernels.hpp"
 #include "prng_engine.hpp"
 #include "mpi.h"
 #include <functional>
@@ -45,6 +49,9 @@ class graph_slice {
 
     //Data is stored in row-major order
     T* slice = NULL;
+
+    //false if the memory is borrowed (e.g. from an rc_workspace), free_slice leaves it alone then
+    bool owns_memory = true;
     
     bool padding_is_zero() const;
 
@@ -57,11 +64,16 @@ public:
     //The rank is the rank of the slice within the graph, that is the first slice has rank 0
     //Time: O(1)
 
-    graph_slice(int vertices, int rows_per_slice, int rank, int size, T * data);
+    //With owned = false, data stays owned by the caller
+    graph_slice(int vertices, int rows_per_slice, int rank, int size, T * data, bool owned = true);
 
     //Copies this slice, allocates separate memory for the new slice
     //Time: O(n k), where n is the size of the graph and k is the number of rows in this slice
     graph_slice<T> deep_copy();
+
+    //Copies this slice into memory owned by the caller, which has to hold at least size * rows_per_slice entries
+    //Time: O(n k), where n is the size of the graph and k is the number of rows in this slice
+    graph_slice<T> copy_to(T * memory) const;
     
     //Default constructor.
     //Time: O(1)
@@ -100,7 +112,7 @@ public:
     //Time: O(1)
     T* get(long i, long j) const;
 
-    //Deallocates slice's memory.
+    //Deallocates slice's memory (unless it is borrowed).
     //Time: O(1).
     void free_slice();
 
@@ -112,11 +124,17 @@ public:
     //Time: O(k), where k is the number of rows in this slice
     void remove_loops();
 
-    //Creates a new slice by combining the columns of this slice as indicated by the relabeling
-    void combine_cols_using_relabeling(graph_slice<T> * dest_graph, int * relabeling) const;
-
-    //Creates a new slice by combining the columns of this slice as indicated by the relabeling
-    void combine_cols_using_relabeling_t(graph_slice<T> * dest_graph, int * relabeling) const;
+    //Combines the columns of this slice as grouped by the runs and packs the result for an all-to-all:
+    //block q (k x k, row major) gets the combined columns [q k, (q+1) k) of every row of this slice
+    //The rows are split among the threads of the global pool
+    //Time: O(n k), a single pass over the slice
+    void pack_combined_cols(T * blocks, const combine_kernels::column_runs & runs) const;
+
+    //Counterpart of pack_combined_cols on the receiving side: block s holds (row of slice s, column of this slice).
+    //Overwrites this slice with the transpose of the blocks, combining the rows as grouped by the runs
+    //The tiles of rows of this slice are split among the threads of the global pool
+    //Time: O(n k), a single pass over the blocks
+    void unpack_combined_rows(const T * blocks, const combine_kernels::column_runs & runs);
     
     //Prints the matrix to std::cout in row major order
     //The communicator given must be such that the ranks in the communicator correspond the ranks of the slices
@@ -128,27 +146,41 @@ public:
 };
 
 
-//Creates prefix sums for a slice of the graph, allowing to select random edges in logarithmic time per edge
+//Prefix sums over a slice of the graph, allowing to select random edges in logarithmic time per edge
+//The row totals are computed up front, the prefix sums of a row only when the first edge is selected in it.
+//All rows share one contiguous block, so the search within a row is a binary search over consecutive memory.
+//The index can be refreshed for a changed slice (e.g. by the next try of a contraction), which reuses the memory.
 template <typename T>
 class graph_slice_index {
 
-    int row_offset; //the first row of this slice corresponds to the row_offset-th vertex in the graph
-    int number_of_rows;
-    T * sums;
-    sum_tree<T> * capacities;//index over the sum of each row
-    sum_tree<T> ** edge_weights;//indices, each over one row
+    const graph_slice<T> * graph = nullptr;
 
-public:
+    int row_offset = 0; //the first row of this slice corresponds to the row_offset-th vertex in the graph
+    long columns = 0;
 
-    //Selects an edge in the slice with probability proportional to its weight
-    //Time: O(log n), where n is the number of vertices in the graph
-    void select_random_edge(edge_struct_t * result, sitmo::prng_engine * random_engine);
+    std::vector<T> row_prefix_sums; //total weight of the rows up to and including row i
+    std::vector<T> prefix_sums; //prefix sums of row i start at i * columns, valid once indexed[i] is set
+    std::vector<char> indexed;
 
-    ~graph_slice_index();
+public:
+
+    //Time: O(1)
+    graph_slice_index() {}
 
     //Time: O(n k), where n is the number of vertices in the graph and k is the number of rows in this slice
-    graph_slice_index(graph_slice<T> * graph);
+    explicit graph_slice_index(const graph_slice<T> * graph) { refresh(graph); }
+
+    //Indexes the given slice, forgetting the prefix sums of all rows
+    //Time: O(n k), a single pass reading the slice
+    void refresh(const graph_slice<T> * graph);
 
+    //Sum of all weights in the slice
+    //Time: O(1)
+    T total() const { return row_prefix_sums.empty() ? T() : row_prefix_sums.back(); }
+
+    //Selects an edge in the slice with probability proportional to its weight
+    //Time: O(log n), where n is the number of vertices in the graph, plus O(n) for the first edge in a row
+    void select_random_edge(edge_struct_t * result, sitmo::prng_engine * random_engine);
 
 };
 
@@ -159,12 +191,13 @@ public:
 ////
 
 template <typename T>
-graph_slice<T>::graph_slice(int vertices, int rows_per_slice, int rank, int size, T * data) {
+graph_slice<T>::graph_slice(int vertices, int rows_per_slice, int rank, int size, T * data, bool owned) {
     number_of_vertices = vertices;
     this->size = size;
     rows_per_node = rows_per_slice;
     slice = data;
     this->rank = rank;
+    owns_memory = owned;
 }
 
 template <typename T>
@@ -205,6 +238,16 @@ graph_slice<T> graph_slice<T>::deep_copy() {
     return c;
 }
 
+template <typename T>
+graph_slice<T> graph_slice<T>::copy_to(T * memory) const {
+
+    assert (padding_is_zero());
+
+    std::copy(begin(), get_row(rows_per_node), memory);
+
+    return graph_slice<T>(number_of_vertices, rows_per_node, rank, size, memory, false);
+}
+
 //performs a shallow copy of other into this
 //see http://courses.cms.caltech.edu/cs11/material/cpp/donnie/cpp-ops.html for rules on = overloading
 template <typename T>
@@ -217,16 +260,18 @@ graph_slice<T> & graph_slice<T>::operator= (const graph_slice<T>& other) {
         size = other.get_size();
         slice = other.slice;
         this->rank = other.rank;
+        owns_memory = other.owns_memory;
     }
 	return *this;
 }
 
 template <typename T>
 void graph_slice<T>::free_slice() {
-    if(slice != nullptr) {
+    if(slice != nullptr && owns_memory) {
 		delete[] slice;
     }
 	slice = nullptr;
+	owns_memory = true;
 }
 
 template <typename T>
@@ -329,41 +374,63 @@ void graph_slice<T>::set_number_of_vertices(int v) {
 }
 
 template <typename T>
-void graph_slice<T>::combine_cols_using_relabeling(graph_slice<T> * dest, int * relabeling) const {
+void graph_slice<T>::pack_combined_cols(T * blocks, const combine_kernels::column_runs & runs) const {
+
+    long k = get_rows_per_slice();
+    long labels = runs.labels();
+    assert (labels <= size);
+
+    combine_kernels::segmented_sums_t<T> segmented_sums = combine_kernels::select_segmented_sums<T>();
 
-    std::fill<T*>(dest->begin(), dest->get_row(get_rows_per_slice()), T());
+    thread_pool::global().parallel_for(k, [&](long row) {
+        const T * source = get_row(row);
 
-    for (int col = 0; col < get_size(); ++col) {
-        int destination_col = relabeling[col];
+        //The combined row is written straight into the blocks, the labels past the last one are padding
+        for (long block = 0; block < size / k; ++block) {
+            T * destination = blocks + block*k*k + row*k;
+            long first = std::min(block*k, labels), last = std::min((block+1)*k, labels);
 
-        //Sum column
-        for (int row = 0; row < get_rows_per_slice(); ++row) {
-            *dest->get(row, destination_col) += *get(row, col);
+            segmented_sums(source, runs, (int) first, (int) last, destination);
+            std::fill(destination + (last - first), destination + k, T());
         }
-    }
+    });
 }
 
 template <typename T>
-void graph_slice<T>::combine_cols_using_relabeling_t(graph_slice<T> * dest, int * relabeling) const {
-    
-    std::fill<T*>(dest->begin(), dest->get_row(get_rows_per_slice()), T());
-    
+void graph_slice<T>::unpack_combined_rows(const T * blocks, const combine_kernels::column_runs & runs) {
+
     long k = get_rows_per_slice();
-    
-    for (long col = 0; col < get_number_of_vertices(); ++col) {
-        long destination_col = relabeling[col];
-        
-        std::transform<T*>(slice+col*k, slice+(col+1)*k, dest->begin()+destination_col*k, dest->begin()+destination_col*k, std::plus<T>());
-        
-        //Sum column in the transposed matrix
-        //for (int row = 0; row < get_rows_per_slice(); ++row) {
-            //*dest->get(destination_col, row) += *get(col, row);
-            //*dest->get(destination_col % k, (destination_col / k) * k + row) += *get(col % k, (col / k) * k + row);
-        //}
-    }
-    
-}
+    long labels = runs.labels();
+    assert (labels <= size);
+
+    //Row `vertex` of the blocks starts at vertex*k. Work on tiles of columns of the blocks: the rows of a run are
+    //summed with contiguous (vectorized) adds, and the writes stay within a few rows of this slice
+    const long tile = 32;
+
+    thread_pool::global().parallel_for((k + tile - 1) / tile, [&](long t) {
+        long first = t * tile, width = std::min(first + tile, k) - first;
+        T sums[tile];
+
+        for (long i = first; i < first + width; ++i) {
+            std::fill(get(i, labels), get_row(i + 1), T());
+        }
+
+        for (long label = 0; label < labels; ++label) {
+            std::fill(sums, sums + width, T());
+
+            for (int j = runs.run_offsets[label]; j < runs.run_offsets[label + 1]; ++j) {
+                const T * source = blocks + runs.order[j]*k + first;
+                for (long i = 0; i < width; ++i) {
+                    sums[i] += source[i];
+                }
+            }
 
+            for (long i = 0; i < width; ++i) {
+                slice[(first + i)*size + label] = sums[i];
+            }
+        }
+    });
+}
 
 template <typename T>
 bool graph_slice<T>::padding_is_zero() const {
@@ -382,51 +449,46 @@ bool graph_slice<T>::padding_is_zero() const {
 
 
 template <typename T>
-void graph_slice_index<T>::select_random_edge(edge_struct_t * result, sitmo::prng_engine * random_engine) {
-
-    std::uniform_int_distribution<long> uniform_row(1, capacities->root());
-
-    result->v1 = capacities->lower_bound(uniform_row(*random_engine));
+void graph_slice_index<T>::refresh(const graph_slice<T> * graph) {
 
-    std::uniform_int_distribution<long> uniform_column(1, edge_weights[result->v1]->root());
+    this->graph = graph;
 
-    result->v2 = edge_weights[result->v1]->lower_bound(uniform_column(*random_engine));
+    int rows = graph->get_rows_per_slice();
+    row_offset = graph->get_rank() * rows;
+    columns = graph->get_number_of_vertices();
 
-    result->v1 += row_offset;
-
-    //std::cout << result->v1 << ", " << result->v2 << std::endl;
-}
-
-template <typename T>
-graph_slice_index<T>::~graph_slice_index() {
+    row_prefix_sums.resize(rows);
+    indexed.assign(rows, 0);
+    if (prefix_sums.size() < (size_t) rows * columns) {
+        prefix_sums.resize((size_t) rows * columns);
+    }
 
-    delete[] sums;
-    delete capacities;
-    for (int i=0; i<number_of_rows; ++i) {
-        delete edge_weights[i];
+    T sum = T();
+    for (int i = 0; i < rows; ++i) {
+        sum = std::accumulate(graph->get_row(i), graph->get_row(i) + columns, sum);
+        row_prefix_sums[i] = sum;
     }
-    delete[] edge_weights;
 }
 
 template <typename T>
-//The rank is the rank of the slice within the graph, that is the first slice has rank 0
-graph_slice_index<T>::graph_slice_index(graph_slice<T> * graph) {
-
-    number_of_rows = graph->get_rows_per_slice();
+void graph_slice_index<T>::select_random_edge(edge_struct_t * result, sitmo::prng_engine * random_engine) {
 
-    row_offset = graph->get_rank() * graph->get_rows_per_slice();
+    assert (total() > 0);
 
-    edge_weights = new sum_tree<T>*[number_of_rows];
+    std::uniform_int_distribution<long> uniform_row(1, total());
 
-    sums = new T[number_of_rows];
+    long row = std::lower_bound(row_prefix_sums.begin(), row_prefix_sums.end(), (T) uniform_row(*random_engine)) - row_prefix_sums.begin();
 
-    for (int i=0; i<number_of_rows; ++i) {
-        edge_weights[i] = new sum_tree<T>(graph->get_row(i), graph->get_number_of_vertices());
-        sums[i] = edge_weights[i]->root();
+    T * row_sums = prefix_sums.data() + row * columns;
+    if (!indexed[row]) {
+        std::partial_sum(graph->get_row(row), graph->get_row(row) + columns, row_sums);
+        indexed[row] = 1;
     }
 
-    capacities = new sum_tree<T>(sums, number_of_rows);
+    std::uniform_int_distribution<long> uniform_column(1, row_sums[columns - 1]);
 
+    result->v1 = (int) row + row_offset;
+    result->v2 = (int) (std::lower_bound(row_sums, row_sums + columns, (T) uniform_column(*random_engine)) - row_sums);
 }
 
 #endif /* graph_slice_h */
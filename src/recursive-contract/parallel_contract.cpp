@@ -8,8 +8,13 @@
 
 #include "parallel_contract.hpp"
 #include "connected_components.hpp"
-#include "matrices.hpp"
 #include "MPICollector.hpp"
+#include "MPIDatatype.hpp"
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+#define MERGETAG 4
 
 namespace mincut {
     
@@ -17,50 +22,101 @@ namespace mincut {
         return int(pow(number_of_vertices, 1.2)) + 1;
     }
     
-    //Selects for every processor a number of edges to select
-    //Every edge is assigned to some processor P with probability proportional to the sum of all edges stored in processor P
-    //The routine selects the order in which edges were assigned to the processors
-    void select_number_of_edges_per_processor(int p, int number_of_edges_to_select, long * sums, int ** edges_per_processor, int ** edges_processor_order, sitmo::prng_engine * random_engine) {
-        
-        assert (p>1);
-        assert (number_of_edges_to_select>0);
-        assert (edges_processor_order);
-        assert (edges_per_processor);
-        assert (random_engine);
-        assert (sums);
-        
-        //std::cout << "choose " << number_of_edges_to_select << std::endl;
-        
-        *edges_per_processor = new int[p];
-        *edges_processor_order = new int[number_of_edges_to_select];
+    //Every processor draws the same numbers of edges per processor from a stream seeded identically everywhere
+    //Jointly, the counts are multinomial with probabilities proportional to the sums: conditioned on the edges assigned
+    //to the processors before it, processor i gets a binomial number of the remaining edges, with probability
+    //sums[i] / (the weight of processors i, i+1, ...)
+    //Time: O(p)
+    std::vector<int> select_number_of_edges_per_processor(const std::vector<long> & sums, int number_of_edges_to_select, sitmo::prng_engine * shared_engine) {
 
-        sum_tree<long> index(sums, p);//The index has a representation similar to a prefix-sum, it allows to quickly select indices with probability proporional to their weight
-        
-        std::fill(*edges_per_processor, *edges_per_processor+p, (int)0);
-        
-        long sum = index.root();
-        
-        std::uniform_int_distribution<long> uniform_int(1, sum);
+        assert (number_of_edges_to_select > 0);
 
-        for (int i=0; i<number_of_edges_to_select; ++i) {
-            
-            long r = uniform_int(*random_engine);
-            int selection = index.lower_bound(r);
-            
-            (*edges_per_processor)[selection] += 1;
-            (*edges_processor_order)[i] = selection;
-            
-            //std::cout << "processor " << selection << std::endl;
+        std::vector<int> edges_per_processor(sums.size(), 0);
+
+        long remaining_weight = std::accumulate(sums.begin(), sums.end(), 0L);
+        int remaining_edges = number_of_edges_to_select;
+
+        assert (remaining_weight > 0);
+
+        for (size_t i = 0; i < sums.size() && remaining_edges > 0; ++i) {
+            if (sums[i] >= remaining_weight) {
+                edges_per_processor[i] = remaining_edges;
+                break;
+            }
+
+            std::binomial_distribution<int> binomial(remaining_edges, (double) sums[i] / (double) remaining_weight);
+            edges_per_processor[i] = binomial(*shared_engine);
+
+            remaining_edges -= edges_per_processor[i];
+            remaining_weight -= sums[i];
         }
-        
+
+        return edges_per_processor;
     }
-    
-    void select_edges(int number_of_edges_to_select, edge_struct_t * select_edges, graph_slice_index<long> * prefix_sums, sitmo::prng_engine * random_engine) {
-        
-        for (int i=0; i<number_of_edges_to_select; ++i) {
-            prefix_sums->select_random_edge(&select_edges[i], random_engine);
+
+    //A sampled edge with the random key placing it in the sample
+    typedef struct {
+        unsigned long key;
+        edge_struct_t edge;
+    } keyed_edge_struct_t;
+
+    //The caller has to free the type
+    MPI_Datatype create_keyed_edge_t() {
+        int block_lengths[3] = { 1, 1, 1 };
+        MPI_Aint displacements[3] = {
+            offsetof(keyed_edge_struct_t, key),
+            offsetof(keyed_edge_struct_t, edge.v1),
+            offsetof(keyed_edge_struct_t, edge.v2)
+        };
+        MPI_Datatype types[3] = { MPI_UNSIGNED_LONG, MPI_INT, MPI_INT };
+
+        MPI_Datatype struct_t, keyed_edge_t;
+        MPI_Type_create_struct(3, block_lengths, displacements, types, &struct_t);
+        MPI_Type_create_resized(struct_t, 0, sizeof(keyed_edge_struct_t), &keyed_edge_t);
+        MPI_Type_free(&struct_t);
+        MPI_Type_commit(&keyed_edge_t);
+
+        return keyed_edge_t;
+    }
+
+    //Merges the runs (sorted by key) of all processors along a binomial tree, the root ends up with all of them
+    //Every processor knows the length of every run, so the receives are sized in advance
+    //Time: O(s) at the root and O(s/p log p) elsewhere, where s is the total length. O(log p) communication rounds
+    std::vector<keyed_edge_struct_t> merge_to_root(MPI_Comm comm, std::vector<keyed_edge_struct_t> run, const std::vector<int> & run_lengths) {
+
+        int p, rank;
+        MPI_Comm_size(comm, &p);
+        MPI_Comm_rank(comm, &rank);
+
+        MPI_Datatype keyed_edge_t = create_keyed_edge_t();
+        MPI_Request request;
+
+        auto by_key = [](keyed_edge_struct_t const & a, keyed_edge_struct_t const & b) { return a.key < b.key; };
+
+        for (int step = 1; step < p; step *= 2) {
+            if (rank % (2*step) == step) {
+                MPI::Isend(run.data(), (int) run.size(), keyed_edge_t, rank - step, MERGETAG, comm, &request);
+                MPI::Wait(&request, MPI_STATUS_IGNORE);
+                run.clear();
+                break;
+            }
+
+            if (rank + step < p) {
+                int last = std::min(rank + 2*step, p);
+                int incoming_length = std::accumulate(run_lengths.begin() + rank + step, run_lengths.begin() + last, 0);
+
+                std::vector<keyed_edge_struct_t> incoming(incoming_length), merged(run.size() + incoming_length);
+                MPI::Irecv(incoming.data(), incoming_length, keyed_edge_t, rank + step, MERGETAG, comm, &request);
+                MPI::Wait(&request, MPI_STATUS_IGNORE);
+
+                std::merge(run.begin(), run.end(), incoming.begin(), incoming.end(), merged.begin(), by_key);
+                run.swap(merged);
+            }
         }
-        
+
+        MPI_Type_free(&keyed_edge_t);
+
+        return run;
     }
     
     int rank_labels(int * source, int * destination, int n) {
@@ -84,123 +140,71 @@ namespace mincut {
     }
 
 
-    /** FIXME: PROFILING? You'll know better **/
-    void parallel_sample_edges(MPI_Comm comm, graph_slice<long> * graph, sitmo::prng_engine * random_generator, edge_struct_t * edge_sample) {
+    //Slice is graph_slice<T> or sparse_graph_slice<T>, Index is the matching index type
+    //The processors agree on how many edges each of them samples (the totals are allgathered with a seed from the root),
+    //sample their edges locally and tag them with random keys. Merging the runs by key at the root yields the edges in
+    //a uniformly random order, as if every edge had been assigned to its processor in turn.
+    //index has to be built for the current graph
+    template <typename T, typename Slice, typename Index>
+    void parallel_sample_edges(MPI_Comm comm, Slice * graph, Index & index, sitmo::prng_engine * random_generator, edge_struct_t * edge_sample) {
         
         int p;
         int rank;
         MPI_Comm_size(comm, &p);
         MPI_Comm_rank(comm, &rank);
         
-        long sum = 0;
-        long * sums = NULL;
-        
         assert (graph != NULL);
         
-        if (rank == 0) {
-            //Master process
-            sums = new long[p];
-            
-        }
-        
-        sum = graph->accumulate();
-        
-        
-        MPI::Gather(&sum, 1, MPI_LONG, sums, 1, MPI_LONG, 0, comm);
-        
-        int * edges_per_processor = NULL;
-        int number_of_edges_to_select = 0;
-        int * edges_processor_order = NULL;
-        graph_slice_index<long> * prefix_sums = NULL;
-        int sample_size = number_of_edges_to_sample_r(graph->get_number_of_vertices());
-        
+        //Every processor contributes its total weight, the root also the seed of the shared stream
+        long local[2] = { (long) index.total(), rank == 0 ? (long) (*random_generator)() : 0 };
+        std::vector<long> gathered(2 * p);
+        MPI::Allgather(local, 2, MPI_LONG, gathered.data(), 2, MPI_LONG, comm);
         
-        if (rank == 0) {
-            //select how many edges per processor
-            select_number_of_edges_per_processor(p, sample_size, sums, &edges_per_processor, &edges_processor_order, random_generator);
-            
-            assert (edges_per_processor);
-            assert (edges_processor_order);
-            
+        std::vector<long> sums(p);
+        for (int i = 0; i < p; ++i) {
+            sums[i] = gathered[2 * i];
         }
-        // compute the prefix sums
-        prefix_sums = new graph_slice_index<long>(graph);
-        
         
-        MPI::Scatter(edges_per_processor, 1, MPI_INT, &number_of_edges_to_select, 1, MPI_INT, 0, comm);
-
-
-        edge_struct_t * selected_edges = NULL;
-        int * recv_displacements = NULL;
+        sitmo::prng_engine shared_engine((uint32_t) gathered[1]);
+        int sample_size = number_of_edges_to_sample_r(graph->get_number_of_vertices());
+        std::vector<int> edges_per_processor = select_number_of_edges_per_processor(sums, sample_size, &shared_engine);
         
+        //select as many random edges as assigned to this processor
+        std::vector<keyed_edge_struct_t> selected_edges(edges_per_processor[rank]);
         
-        if (rank == 0) {
-            selected_edges = new edge_struct_t[sample_size];
-            
-            //The edges of the other processors are received next to each other => use prefix scan to compute the displacements
-            recv_displacements = new int[p];
-            recv_displacements[0] = 0;
-            std::partial_sum(edges_per_processor, edges_per_processor+p-1, recv_displacements+1);
+        if (!selected_edges.empty()) {
+            for (auto & selected : selected_edges) {
+                index.select_random_edge(&selected.edge, random_generator);
+                selected.key = ((unsigned long) (*random_generator)() << 32) | (unsigned long) (*random_generator)();
+            }
             
-        } else {
-            selected_edges = new edge_struct_t[number_of_edges_to_select];
+            std::sort(selected_edges.begin(), selected_edges.end(), [](keyed_edge_struct_t const & a, keyed_edge_struct_t const & b) {
+                return a.key < b.key;
+            });
         }
-        //select as many random edges as indicated by the root
-
-        /** FIXME: PROFILING? You'll know better **/
-        select_edges(number_of_edges_to_select, selected_edges, prefix_sums, random_generator);
-        
-        
         
-        //Gather the selected edges at the root, in processor order
-        MPI::Gatherv(rank ? selected_edges : MPI_IN_PLACE, number_of_edges_to_select, MPI_2INT, selected_edges, edges_per_processor, recv_displacements, MPI_2INT, 0, comm);
+        std::vector<keyed_edge_struct_t> merged = merge_to_root(comm, std::move(selected_edges), edges_per_processor);
         
         if (rank == 0) {
-            //root permutes edges according to the order edges were assigned to processors to begin with
-            //If we would leave this step out, the edges would not have the right distribution: edges with smaller endpoints would be more likely to come early in the permutation
+            assert ((int) merged.size() == sample_size);
             
             for (int i=0; i<sample_size; ++i) {
-                assert (recv_displacements[edges_processor_order[i]] < sample_size);
-                
-                edge_sample[i] = selected_edges[recv_displacements[edges_processor_order[i]]++];
+                edge_sample[i] = merged[i].edge;
             }
-
         }
-        
-        if (recv_displacements) delete[] recv_displacements;
-        if (edges_processor_order) delete[] edges_processor_order;
-        if (sums) delete[] sums;
-        if (prefix_sums) delete prefix_sums;
-        if (edges_per_processor) delete[] edges_per_processor;
-        if (selected_edges) delete [] selected_edges;
     }
     
-    void distributed_matrix_transpose(long * src, long * dest, int k, int v, MPI_Comm comm);
-    
-    int parallel_contract_try(MPI_Comm comm, graph_slice<long> * graph, sitmo::prng_engine * random_generator, int target_v);
-    
-    void parallel_contract(MPI_Comm comm, graph_slice<long> * graph, sitmo::prng_engine * random_generator, int target_v) {
+    //Samples edges, lets the root contract them until target_v components remain and broadcasts the result
+    //relabeling has to hold number_of_vertices+1 entries: the new label of every vertex and the new number of vertices
+    //unnormalized_relabeling is scratch space for number_of_vertices labels at the root (allocated if nullptr)
+    //index has to be built for the current graph
+    //Returns the new number of vertices
+    template <typename T, typename Slice, typename Index>
+    int sample_relabeling(MPI_Comm comm, Slice * graph, Index & index, sitmo::prng_engine * random_generator, int target_v, int * relabeling,
+                          int * unnormalized_relabeling = nullptr) {
         
-        int cur = graph->get_number_of_vertices();
-        
-        while ((cur = parallel_contract_try(comm, graph, random_generator, target_v)) > target_v) {
-            //std::cout << "v: " << cur << "/ target: " << target_v << std::endl;
-        };
-    }
-    
-    int parallel_contract_try(MPI_Comm comm, graph_slice<long> * graph, sitmo::prng_engine * random_generator, int target_v) {
-    
-        int p;
         int rank;
-        
-        MPI_Comm_size(comm, &p);
         MPI_Comm_rank(comm, &rank);
-    
-        int v = graph->get_size();
-        int k = graph->get_rows_per_slice();
-        
-        assert (p > 1);
-        assert (k*p == v);
         
         int virtual_v = graph->get_number_of_vertices();
         
@@ -210,16 +214,15 @@ namespace mincut {
             edge_sample = new edge_struct_t[number_of_edges_to_sample_r(virtual_v)];
         }
         
-        parallel_sample_edges(comm, graph, random_generator, edge_sample);
-        
-        int * relabeling = new int[virtual_v+1];
+        parallel_sample_edges<T, Slice, Index>(comm, graph, index, random_generator, edge_sample);
         
         int actual_v;
         
         if (rank == 0) {
             //root performs CC computation
 
-            int * unnormalized_relabeling = new int[virtual_v];
+            bool owned = unnormalized_relabeling == nullptr;
+            if (owned) unnormalized_relabeling = new int[virtual_v];
             
             size_t prefix_length;
             
@@ -233,7 +236,7 @@ namespace mincut {
 
             assert (actual_v >= target_v);
             
-            delete[] unnormalized_relabeling;
+            if (owned) delete[] unnormalized_relabeling;
             delete[] edge_sample;
             edge_sample = NULL;
             
@@ -243,75 +246,84 @@ namespace mincut {
         //root broadcasts CC computation results
         //MPI_Bcast(&actual_v, 1, MPI_INT, 0, comm);
         MPI::Bcast(relabeling, virtual_v+1, MPI_INT, 0, comm);
-        actual_v = relabeling[virtual_v];
-
-        //Contract the graph by combining rows and columns of the matrix
-        //This is done by first combining columns locally, then performing a distributed matrix transpose, and then again combining columns locally. Note that combining columns of the transposed matrix corresponds to combining the rows of the original matrix
-        //Finally, the diagonal of the matrix is zeroed, so that loops are removed
-        
-        //graph->print(comm);
+        return relabeling[virtual_v];
+    }
+    
+    template <typename T>
+    void distributed_matrix_transpose(T * src, T * dest, int k, int v, MPI_Comm comm);
+    
+    template <typename T>
+    int parallel_contract_try(MPI_Comm comm, graph_slice<T> * graph, graph_slice_index<T> & index, sitmo::prng_engine * random_generator, int target_v,
+                              rc_workspace<T> * workspace);
+    
+    //The index is kept across the tries (and in the workspace across the levels), so its memory is allocated once
+    template <typename T>
+    void parallel_contract(MPI_Comm comm, graph_slice<T> * graph, sitmo::prng_engine * random_generator, int target_v, rc_workspace<T> * workspace) {
         
-        long * aux_graph = new long[(long)v * k];
-        graph_slice<long> shrinked_graph(virtual_v, k, graph->get_rank(), v, aux_graph);
-            
-        //nodes locally combine columns of the matrix
-        //graph->combine_cols_using_relabeling(&shrinked_graph, relabeling);
-
-        //shrinked_graph.print(comm);
+        graph_slice_index<T> local_index;
+        graph_slice_index<T> & index = workspace ? workspace->get_index() : local_index;
         
-        /*for (int i=0; i<virtual_v; i+=k) {//Locally transpose blocks
-            matrices::matrixOperations_transpose_co(graph->get(0,i), shrinked_graph.get(0,i), k, k, v, v);
-        }*/
+        int cur = graph->get_number_of_vertices();
         
-        matrices::transpose(graph->begin(), shrinked_graph.begin(), k, v);
+        while ((cur = parallel_contract_try(comm, graph, index, random_generator, target_v, workspace)) > target_v) {
+            //std::cout << "v: " << cur << "/ target: " << target_v << std::endl;
+        };
+    }
+    
+    template <typename T>
+    int parallel_contract_try(MPI_Comm comm, graph_slice<T> * graph, graph_slice_index<T> & index, sitmo::prng_engine * random_generator, int target_v,
+                              rc_workspace<T> * workspace) {
+    
+        int p;
+        int rank;
         
-        //shrinked_graph.print(comm);
+        MPI_Comm_size(comm, &p);
+        MPI_Comm_rank(comm, &rank);
+    
+        int v = graph->get_size();
+        int k = graph->get_rows_per_slice();
         
+        assert (p > 1);
+        assert (k*p == v);
         
-        shrinked_graph.combine_cols_using_relabeling_t(graph, relabeling);
+        int virtual_v = graph->get_number_of_vertices();
         
-        //graph->print(comm);
+        int * relabeling = workspace ? workspace->get_relabeling() : new int[virtual_v+1];
         
-        //graph->print(comm);
+        //Only the row totals are computed here, the prefix sums of a row when an edge is sampled in it
+        index.refresh(graph);
         
-        //std::copy(shrinked_graph.begin(), shrinked_graph.get_row(k), graph->begin());
-
-        /** FIXME: PROFILING? You'll know better **/
-        //Distributed Matrix Transpose
-        distributed_matrix_transpose(graph->begin(), shrinked_graph.begin(), k, v, comm);
-        //distributed_matrix_transpose(shrinked_graph.begin(), graph->begin(), k, v, comm);
+        int actual_v = sample_relabeling<T, graph_slice<T>, graph_slice_index<T>>(comm, graph, index, random_generator, target_v, relabeling,
+                                                                                 workspace ? workspace->get_unnormalized_relabeling() : nullptr);
 
+        //Contract the graph by combining rows and columns of the matrix
+        //The columns are combined while packing the blocks for the distributed matrix transpose. The receiver transposes the blocks into its new rows and combines the rows on the way, so each of the two passes touches the matrix once
+        //Both passes use the same grouping of the vertices by their new label
+        //Finally, the diagonal of the matrix is zeroed, so that loops are removed
         
-        //shrinked_graph.print(comm);
+        combine_kernels::column_runs runs = combine_kernels::group_columns(relabeling, virtual_v, actual_v);
         
-        /*for (int i=0; i<virtual_v; i+=k) {//Locally transpose blocks
-            matrices::matrixOperations_transpose_co(shrinked_graph.get(0,i), graph->get(0,i), k, k, v, v);
-        }*/
+        //With a workspace, the blocks (and then the contracted slice) live in the buffer not holding the graph
+        graph_slice<T> contracted_graph = workspace
+                ? workspace->slice_after(graph->begin(), virtual_v, k, graph->get_rank(), v)
+                : graph_slice<T>(virtual_v, k, graph->get_rank(), v, new T[(long)v * k]);
         
-        for (long i=0; i<virtual_v; i+=k) {//Locally transpose blocks
-            matrices::matrixOperations_transpose_co(shrinked_graph.begin()+i*k, graph->begin()+i*k, k, k, k, k);
-        }
-
+        T * blocks = contracted_graph.begin();
+        graph->pack_combined_cols(blocks, runs);
+        
+        //The slice is not needed anymore after packing, so it receives the blocks
         /** FIXME: PROFILING? You'll know better **/
-        graph->combine_cols_using_relabeling_t(&shrinked_graph, relabeling);
+        distributed_matrix_transpose(blocks, graph->begin(), k, v, comm);
         
-
-        matrices::transpose(shrinked_graph.begin(), graph->begin(), v, k);
+        contracted_graph.unpack_combined_rows(graph->begin(), runs);
         
+        *graph = contracted_graph; //frees the old slice, unless it is in the workspace
         
-        //nodes locally combine columns of the matrix
-        //shrinked_graph.combine_cols_using_relabeling(graph, relabeling);
-
         graph->remove_loops();
         
-        
-        //graph->print(comm);
-
-        delete[] aux_graph;
-        
         graph->set_number_of_vertices(actual_v);
         
-        if (relabeling) delete[] relabeling;
+        if (!workspace) delete[] relabeling;
         
         return actual_v;
     }
@@ -371,16 +383,88 @@ namespace mincut {
         return row_major_block_t;
     }*/
     
-    void distributed_matrix_transpose(long * src, long * dest, int k, int v, MPI_Comm comm) {
+    template <typename T>
+    void distributed_matrix_transpose(T * src, T * dest, int k, int v, MPI_Comm comm) {
         //MPI_Datatype row_major_block_t = create_row_major_block_t(k, v);
         
         //MPI_Alltoall(src, 1, row_major_block_t, dest, 1, row_major_block_t, comm);
         
-        MPI::Alltoall(src, k*k, MPI_LONG, dest, k*k, MPI_LONG, comm);
+        MPI_Datatype weight_t = MPIDatatype<T>::constructType();
+        MPI::Alltoall(src, k*k, weight_t, dest, k*k, weight_t, comm);
         
         
         //MPI_Type_free(&row_major_block_t);
     }
     
 
+    
+    ////
+    //Sparse contraction
+    ////
+    
+    template <typename T>
+    int parallel_contract_try(MPI_Comm comm, sparse_graph_slice<T> * graph, sparse_graph_slice_index<T> & index, sitmo::prng_engine * random_generator, int target_v,
+                              rc_workspace<T> * workspace);
+    
+    template <typename T>
+    void parallel_contract(MPI_Comm comm, sparse_graph_slice<T> * graph, sitmo::prng_engine * random_generator, int target_v, rc_workspace<T> * workspace) {
+        
+        sparse_graph_slice_index<T> local_index;
+        sparse_graph_slice_index<T> & index = workspace ? workspace->get_sparse_index() : local_index;
+        
+        while (parallel_contract_try(comm, graph, index, random_generator, target_v, workspace) > target_v) {}
+    }
+    
+    //Same sampling as the dense version. Instead of combining rows and columns, every entry is relabeled and sent
+    //to the owner of its new row, which sums up the entries that ended up in the same position.
+    //Time: O(m log m) locally, where m is the number of entries of the slice
+    template <typename T>
+    int parallel_contract_try(MPI_Comm comm, sparse_graph_slice<T> * graph, sparse_graph_slice_index<T> & index, sitmo::prng_engine * random_generator, int target_v,
+                              rc_workspace<T> * workspace) {
+        
+        int p;
+        MPI_Comm_size(comm, &p);
+        
+        int k = graph->get_rows_per_slice();
+        
+        assert (p > 1);
+        
+        int virtual_v = graph->get_number_of_vertices();
+        
+        int * relabeling = workspace ? workspace->get_relabeling() : new int[virtual_v+1];
+        
+        index.refresh(graph);
+        
+        int actual_v = sample_relabeling<T, sparse_graph_slice<T>, sparse_graph_slice_index<T>>(comm, graph, index, random_generator, target_v, relabeling,
+                                                                                               workspace ? workspace->get_unnormalized_relabeling() : nullptr);
+        
+        //relabel the entries, the loops created by the contraction are dropped right away
+        std::vector<weighted_edge_struct_t> entries;
+        entries.reserve(graph->get_entry_count());
+        graph->entries(entries);
+        
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [&](weighted_edge_struct_t & entry) {
+            entry.v1 = relabeling[entry.v1];
+            entry.v2 = relabeling[entry.v2];
+            return entry.v1 == entry.v2;
+        }), entries.end());
+        
+        std::vector<weighted_edge_struct_t> incoming = send_to_row_owners(comm, entries, k);
+        
+        *graph = sparse_graph_slice<T>(actual_v, k, graph->get_rank(), incoming);
+        
+        if (!workspace) delete[] relabeling;
+        
+        return actual_v;
+    }
+    
+    ////
+    //Instantiations for the supported weight types
+    ////
+    
+    template void parallel_contract<int>(MPI_Comm, graph_slice<int> *, sitmo::prng_engine *, int, rc_workspace<int> *);
+    template void parallel_contract<long>(MPI_Comm, graph_slice<long> *, sitmo::prng_engine *, int, rc_workspace<long> *);
+    template void parallel_contract<int>(MPI_Comm, sparse_graph_slice<int> *, sitmo::prng_engine *, int, rc_workspace<int> *);
+    template void parallel_contract<long>(MPI_Comm, sparse_graph_slice<long> *, sitmo::prng_engine *, int, rc_workspace<long> *);
+    
 }
@@ -12,10 +12,22 @@
 #include "mpi.h"
 #include "prng_engine.hpp"
 #include "graph_slice.hpp"
+#include "sparse_graph_slice.hpp"
+#include "rc_workspace.hpp"
 
 namespace mincut {
     
-    void parallel_contract(MPI_Comm comm, graph_slice<long> * graph, sitmo::prng_engine * random_generator, int target_vertices);
+    //Instantiated for int and long weights
+    //With a workspace, the contracted slice goes to the workspace buffer not holding the graph
+    template <typename T>
+    void parallel_contract(MPI_Comm comm, graph_slice<T> * graph, sitmo::prng_engine * random_generator, int target_vertices,
+                           rc_workspace<T> * workspace = nullptr);
+    
+    //Sparse version: the slices keep their rows_per_slice, the entries move to the owners of their new rows
+    //With a workspace, the tries take their relabeling and index from it
+    template <typename T>
+    void parallel_contract(MPI_Comm comm, sparse_graph_slice<T> * graph, sitmo::prng_engine * random_generator, int target_vertices,
+                           rc_workspace<T> * workspace = nullptr);
     
 }
 
@@ -0,0 +1,29 @@
+//
+//  rc_workspace.cpp
+//
+
+#include <algorithm>
+#include "rc_workspace.hpp"
+#include "recursive_contract.hpp"
+
+template <typename T>
+size_t rc_workspace<T>::required_capacity(int vertices, int rows_per_slice, int size, int p) {
+    size_t capacity = (size_t) rows_per_slice * size;
+
+    //Follows the shapes of reassign_graph level by level: w2 = ceil(x/p2) rows of n2 = w2*p2 entries
+    while (p > 1) {
+        int x = mincut::contraction_target(vertices);
+        int p2 = p/2;
+        size_t w2 = (x + p2 - 1) / p2;
+
+        capacity = std::max(capacity, w2 * w2 * p2);
+
+        vertices = x;
+        p = p2;
+    }
+
+    return capacity;
+}
+
+template class rc_workspace<int>;
+template class rc_workspace<long>;
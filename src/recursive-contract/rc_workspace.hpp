@@ -0,0 +1,92 @@
+//
+//  rc_workspace.hpp
+//
+//  Memory for the dense recursion of one group, allocated once and reused by every contraction step and trial.
+//  Two buffers of matrix entries are used in turns (ping-pong): a step reads the slice from one and writes the
+//  contracted, reassigned or copied slice into the other. Both are sized for the largest level of the recursion.
+//  The sparse recursion only uses the scratch space of the contraction tries, its workspaces have no buffers.
+//
+
+#ifndef rc_workspace_hpp
+#define rc_workspace_hpp
+
+#include <cstddef>
+#include <vector>
+#include <new>
+#include "graph_slice.hpp"
+#include "sparse_graph_slice.hpp"
+#include "huge_pages.h"
+
+template <typename T>
+class rc_workspace {
+
+    size_t capacity;
+    huge_pages::block blocks[2];
+    T * buffers[2];
+
+    std::vector<int> relabeling;
+    std::vector<int> unnormalized_relabeling;
+
+    graph_slice_index<T> index;
+    sparse_graph_slice_index<T> sparse_index;
+
+public:
+
+    //A capacity of 0 allocates no buffers. Large buffers are backed by transparent huge pages
+    //Time: O(1), the memory is only touched by its first use
+    rc_workspace(size_t capacity, int vertices) : capacity(capacity), relabeling(vertices + 1), unnormalized_relabeling(vertices) {
+        for (int i = 0; i < 2; ++i) {
+            if (capacity > 0) {
+                blocks[i] = huge_pages::allocate(capacity * sizeof(T), huge_pages::TRANSPARENT);
+                if (!blocks[i].memory) {
+                    throw std::bad_alloc();
+                }
+            }
+            buffers[i] = static_cast<T *>(blocks[i].memory);
+        }
+    }
+
+    ~rc_workspace() {
+        for (huge_pages::block & block : blocks) {
+            huge_pages::release(block);
+        }
+    }
+
+    rc_workspace(const rc_workspace &) = delete;
+    rc_workspace & operator= (const rc_workspace &) = delete;
+
+    //Entries of the largest slice of the recursion of a graph with the given shape on p (a power of two) processors
+    //Time: O(log p)
+    static size_t required_capacity(int vertices, int rows_per_slice, int size, int p);
+
+    //Time: O(1)
+    size_t get_capacity() const { return capacity; }
+
+    //The buffer which does not hold `current`, which may also be nullptr or memory from elsewhere
+    //Time: O(1)
+    T * other(const T * current) const { return current == buffers[0] ? buffers[1] : buffers[0]; }
+
+    //A slice without data, backed by the buffer not holding `current`
+    //Time: O(1)
+    graph_slice<T> slice_after(const T * current, int vertices, int rows_per_slice, int rank, int size) const {
+        assert ((size_t) rows_per_slice * size <= capacity);
+        return graph_slice<T>(vertices, rows_per_slice, rank, size, other(current), false);
+    }
+
+    //Scratch space for the labels of up to `vertices` vertices (plus one entry for their number)
+    //Time: O(1)
+    int * get_relabeling() { return relabeling.data(); }
+
+    //Time: O(1)
+    int * get_unnormalized_relabeling() { return unnormalized_relabeling.data(); }
+
+    //Index for the edge sampling, refreshed by every contraction try so that its memory is kept
+    //Time: O(1)
+    graph_slice_index<T> & get_index() { return index; }
+
+    //Time: O(1)
+    sparse_graph_slice_index<T> & get_sparse_index() { return sparse_index; }
+
+};
+
+#endif /* rc_workspace_hpp */
@@ -12,10 +12,7 @@
 #include "co_mincut.h"
 #include "utils.hpp"
 #include "MPICollector.hpp"
-
-#define INFOTAG1 0
-#define INFOTAG2 1
-#define SLICETAG 2
+#include "MPIDatatype.hpp"
 
 using namespace std;
 
@@ -42,9 +39,20 @@ namespace mincut {
 	 * relies on the assumption that V > p and that p = 2^k, for some k (k being a natural number).
 	 * When p = 1 a sequential version of the algorithm is called.
 	 */
-	long parallel_cut(MPI_Comm comm, Graph& graph, int trials, int seed) {
+	template <typename T>
+	long parallel_cut(MPI_Comm comm, graph_slice<T>& graph, int trials, int seed) {
+		comm_tree tree(comm);
+		return parallel_cut(tree, graph, trials, seed);
+	}
+
+	/*
+	 * Same as above on the group of a communicator tree, which is reused by all the trials (and by the caller).
+	 */
+	template <typename T>
+	long parallel_cut(const comm_tree & tree, graph_slice<T>& graph, int trials, int seed) {
 		long cut = numeric_limits<long>::max();
 		int rank;
+		MPI_Comm comm = tree.group(0);
 
 		MPI_Comm_rank(comm, &rank);
 
@@ -54,18 +62,26 @@ namespace mincut {
 
 		sitmo::prng_engine random(rank+seed);
 
+		int p;
+		MPI_Comm_size(comm, &p);
+
+		//All the slices of all the trials are placed in the same two buffers
+		rc_workspace<T> workspace(
+				rc_workspace<T>::required_capacity(graph.get_number_of_vertices(), graph.get_rows_per_slice(), graph.get_size(), p),
+				graph.get_number_of_vertices());
+
 		for (int i=0; i<trials; ++i){
 			DebugUtils::print(rank, [&](std::ostream & out) {
 				out << "working on trial " << i << " out of " << trials;
 			});
 			//copy graph
-			Graph copied_graph = graph.deep_copy();
+			graph_slice<T> copied_graph = graph.copy_to(workspace.other(nullptr));
 
 			DebugUtils::print(rank, [&](std::ostream & out) {
-				out << "took deep copy and running RC";
+				out << "took copy and running RC";
 			});
 
-			cut = std::min(cut, parallel_recursive_contract(comm, copied_graph, &random));
+			cut = std::min(cut, parallel_recursive_contract(tree, 0, copied_graph, &random, &workspace));
 		}
 
 		cut = cut_reduce(comm, cut, 0);
@@ -74,7 +90,8 @@ namespace mincut {
 	}
 
 
-	long parallel_cut(MPI_Comm comm, Graph& graph, double success, int seed) {
+	template <typename T>
+	long parallel_cut(MPI_Comm comm, graph_slice<T>& graph, double success, int seed) {
 
 		int trials = 2*comincut::number_of_trials(graph.get_number_of_vertices(), success);
 
@@ -159,99 +176,72 @@ namespace mincut {
 		MPI_Comm_rank(comm, &rank);
 
 		sitmo::prng_engine random(rank);
+		comm_tree tree(comm);
 
-		return parallel_recursive_contract(comm, graph, &random);
+		return parallel_recursive_contract(tree, 0, graph, &random);
 	}
 
 
 	/*
-	 * Given a starting communicator and a graph, it performs a parallelized recursive_contract recursion tree on the graph,
-	 * returning the locally found minimum cut (which might not be the real mincut).
+	 * Given the communicator tree of a group and a graph distributed on the group at the given level, it performs a
+	 * parallelized recursive_contract recursion tree on the graph, returning the locally found minimum cut (which might not be the real mincut).
 	 * It relies on the assumption that V > p and that p = 2^k, for some k (k being a natural number).
 	 * When p = 1 a sequential version of the algorithm is called.
 	 *
+	 * With PROFILE_STEPS, the contraction, reassignment and duplication of every level are timed separately.
+	 *
 	 * ANALYSIS: Time = O(log(p)*(O(n^2/p) + O(parallel_contract_procedure)) + O(serial_contract_procedure);
 	 */
-	long parallel_recursive_contract(MPI_Comm comm, Graph& graph, sitmo::prng_engine * random) {
+	template <typename T>
+	long parallel_recursive_contract(const comm_tree & tree, int level, graph_slice<T>& graph, sitmo::prng_engine * random,
+									 rc_workspace<T> * workspace) {
 		int V, p, rank, x, p2;
 		long cut;
-		MPI_Comm subComm, superComm;
-
-		DebugUtils::print(-1, [&](std::ostream & out) {
-			out << "about to touch communicators";
-		});
+		MPI_Comm superComm;
 
-		superComm = comm;
+		superComm = tree.group(level);
 		MPI_Comm_size(superComm, &p);
 		MPI_Comm_rank(superComm, &rank);
 
-		assert(p % 2 == 0);
+		int worldRank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
 
 		DebugUtils::print(rank, [&](std::ostream & out) {
 			out << "working in group of " << p << " processors";
 		});
 
+		while(p > 1) {
 
-		V = graph.get_number_of_vertices();
-		x = (int) ceil( ((double) V)/sqrt(2.0) + 1.0); //Contract to ceil(n/sqrt(2) + 1).
-		p2 = p/2; //p is a power of two.
-
-
-		//graph.print(superComm);
+			V = graph.get_number_of_vertices();
+			x = contraction_target(V); //Contract to ceil(n/sqrt(2) + 1).
+			p2 = p/2; //p is a power of two.
 
-		/** FIXME: PROFILING? You'll know better **/
-		// Yuck :D
-		while(p > 1) {
+			std::string tag = "rc.level" + std::to_string(level);
 
-			parallel_contract(superComm, &graph, random, x);
-
-			//DEBUG
-			/*int tp;
-			int trank;
-			MPI_Comm_size(comm, &tp);
-			MPI_Comm_rank(comm, &trank);
-			for (int i=0; i<tp/p;++i) {
-				MPI_Barrier(comm);
-				if (i*p <= trank && i*p+p > trank) {
-					graph.print(superComm);
-				}
-			}*/
+			TimeUtils::profileStep([&]() {
+				parallel_contract(superComm, &graph, random, x, workspace);
+			}, worldRank, tag + ".contract");
 
 			assert(graph.get_number_of_vertices() == x);
 
-			reassign_graph(superComm, p2, &graph, x, &subComm);
-			MPI_Comm_free(&subComm);
+			TimeUtils::profileStep([&]() {
+				reassign_graph(superComm, p2, &graph, x, workspace);
+			}, worldRank, tag + ".reassign");
 
-			if(rank < p2) duplicate_graph(superComm, p2, &graph, &subComm);
-			else graph = duplicate_graph(superComm, p2, nullptr, &subComm);
+			TimeUtils::profileStep([&]() {
+				if(rank < p2) duplicate_graph(tree.pair(level), &graph, workspace);
+				else graph = duplicate_graph(tree.pair(level), static_cast<graph_slice<T> *>(nullptr), workspace);
+			}, worldRank, tag + ".duplicate");
 
 			assert(graph.get_number_of_vertices() == x);
 			assert(graph.get_size() < x+p2);
 
-			if(superComm != comm) MPI_Comm_free(&superComm);
-			superComm = subComm;
+			superComm = tree.group(++level);
 			MPI_Comm_size(superComm, &p);
 			assert (p == p2);
 			MPI_Comm_rank(superComm, &rank);
-
-			V = graph.get_number_of_vertices();
-			x = (int) ceil( ((double) V)/sqrt(2.0) + 1.0);
-			p2 = p/2;
-
-			//DEBUG
-			/*MPI_Comm_size(comm, &tp);
-			MPI_Comm_rank(comm, &trank);
-			for (int i=0; i<tp/p;++i) {
-				MPI_Barrier(comm);
-				if (i*p <= trank && i*p+p > trank) {
-					graph.print(superComm);
-				}
-			}*/
-
 		}
 
-
-
 		//serial_contract
 		assert(graph.get_size() == graph.get_number_of_vertices());
 
@@ -259,7 +249,7 @@ namespace mincut {
 			out << "will now run enter the serial part";
 		});
 
-		adjacency_matrix<long> matrix(graph.get_number_of_vertices(), graph.begin());
+		adjacency_matrix<T> matrix(graph.get_number_of_vertices(), graph.begin());
 
 		cut = comincut::minimum_cut_try(&matrix, (*random)());
 
@@ -271,113 +261,61 @@ namespace mincut {
 
 
 	/*
-	 * Given a communicator whose first p processors store a distributed graph, copy the graph
-	 * distributing it to the remaining commSize - p processors and create two communicators
-	 * out of the two mentioned groups. At the end of the call, newComm will contain the new communicator
-	 * assigned to the current processor.
-	 * The communicators are created now to avoid the creation of an "intercommunicator".
-	 * For the time being (p == p2), and the no. of processors is a power of 2.
-	 * The destination processes must call this with nullptr as pGraph.
+	 * Copies the graph from the first to the second process of a pair (see comm_tree). The sender passes its slice,
+	 * the receiver passes nullptr and gets a slice with the same rank within the next group.
+	 * Both the shape and the slice are broadcast within the pair, so there is no point-to-point matching to get wrong
+	 * and the MPI implementation picks the protocol.
 	 *
 	 * ANALYSIS: O(1) communications per processor. Sent/received data = O(n^2/p).
-	 * 				Computations = O(n^2/p). (copy into/from buffer)
 	 */
-	/** FIXME: PROFILING? You'll know better **/
-// I wonder how expensive this is?
-	Graph duplicate_graph(MPI_Comm comm, int p, Graph *pGraph, MPI_Comm *newComm) {
-
-		int w, n, nVertices;
-		MPI_Request req1, req2, req3;
-		MPI_Datatype type = MPI_LONG;
-
-		int commSize;
-		MPI_Comm_size(comm, &commSize);
-
-		int rank; //The rank of the current processor in the communicator.
-		MPI_Comm_rank(comm, &rank);
-
-		//int p2 = p - commSize; //Size of the second group of processors.
-
-		if(rank < p) { //Sender processors.
-
-			assert (pGraph != nullptr);
-
-			Graph& graph = *pGraph;
-
-			int dest = p + rank;
-
-			w = graph.get_rows_per_slice();
-			n = w*p; //N is the actual dimension of the square matrix.
-			nVertices = graph.get_number_of_vertices();
+	template <typename T>
+	graph_slice<T> duplicate_graph(MPI_Comm pairComm, graph_slice<T> *pGraph, rc_workspace<T> * workspace) {
 
-			// Can't this be done as a collective in which all ranks in the new group participate?
-			// If this turns out to take significant time, it might be useful -- from what ive seen big collectives
-			// are always faster than anything you do by hand
-			MPI::Isend(&w, 1, MPI_INT, dest, INFOTAG1, comm, &req1); //Send w to the second group.
-			MPI::Isend(&nVertices, 1, MPI_INT, dest, INFOTAG2, comm, &req2); //Send n to the second group.
+		MPI_Datatype type = MPIDatatype<T>::constructType();
 
-			MPI::Isend(graph.begin(), w*n, type, dest, SLICETAG, comm, &req3); //Send the slice to the assigned second group processor.
-
-			MPI_Comm_split(comm, 0, 0, newComm);
+		int rank;
+		MPI_Comm_rank(pairComm, &rank);
 
-			MPI::Wait(&req1, MPI_STATUS_IGNORE);
-			MPI::Wait(&req2, MPI_STATUS_IGNORE);
-			MPI::Wait(&req3, MPI_STATUS_IGNORE);
+		assert ((rank == 0) == (pGraph != nullptr));
 
-			return graph;
+		long info[4];
+		if (rank == 0) {
+			info[0] = pGraph->get_rows_per_slice();
+			info[1] = pGraph->get_size();
+			info[2] = pGraph->get_number_of_vertices();
+			info[3] = pGraph->get_rank();
 		}
-		else { //Receiver processors.
-
-			int source = rank - p;
-			int nElements;
-
-			MPI::Irecv(&w, 1, MPI_INT, source, INFOTAG1, comm, &req1);
-			MPI::Irecv(&nVertices, 1, MPI_INT, source, INFOTAG2, comm, &req2);
-
-			MPI::Wait(&req1, MPI_STATUS_IGNORE); //We need w to proceed, now.
-			n = w*p;
 
-			long *slice_memory = new long[w*n];
-			nElements = n*w;
-
-			MPI::Irecv(slice_memory, nElements, type, source, SLICETAG, comm, &req3);
-			MPI::Wait(&req3, MPI_STATUS_IGNORE);
-
-			MPI::Wait(&req2, MPI_STATUS_IGNORE); //We need nVertices to proceed, now.
-			Graph copiedGraph (nVertices, w, (rank - p), n, slice_memory);
-
-			MPI_Comm_split(comm, 1, 0, newComm);
+		MPI::Bcast(info, 4, MPI_LONG, 0, pairComm);
 
+		if (rank == 0) { //Sender processor.
+			MPI::Bcast_large(pGraph->begin(), info[0]*info[1], type, 0, pairComm);
+			return *pGraph;
+		}
+		else { //Receiver processor, it holds no slice at this point
+			graph_slice<T> copiedGraph = workspace
+					? workspace->slice_after(nullptr, (int) info[2], (int) info[0], (int) info[3], (int) info[1])
+					: graph_slice<T>((int) info[2], (int) info[0], (int) info[3], (int) info[1], new T[info[0]*info[1]]);
+			MPI::Bcast_large(copiedGraph.begin(), info[0]*info[1], type, 0, pairComm);
 			return copiedGraph;
 		}
 	}
 
 	/*
 	 * Given a graph distributed amongst the processes in the communicator, cleans the graph
-	 * of the contracted vertices (only x vertices remain) and distributes it on a p2-processors subset of the communicator.
-	 * It relies on the only assumption that w2 > w. It can be proved that it always holds for our usage.
-	 * At the end of the call pGraph will point to the new one, for the first p2 processes.
-	 * newComm is a new communicator to the group of the first p2 processes.
+	 * of the contracted vertices (only x vertices remain) and distributes it on the first p2 processes of the communicator,
+	 * w2 = ceil(x/p2) rows and n2 = w2*p2 columns each.
+	 * Every process compacts its rows to n2 columns in place, so the rows for each receiver are contiguous, and
+	 * a single all-to-all moves them. The other processes free their slice.
 	 *
-	 * IMPORTANT: for this method to work the MPI self btl has to be enabled! e.g. "mpirun --mca btl tcp,self".
-	 *
-	 * ANALYSIS: at most O(p/n) communications per processor: if n > p it's O(1).
-	 * 			 Amount of sent/received data is O(n^2/p), the same holds for computations (copy into/from buffer).
-	 * 			 Temporary memory occupation might be as much as 2*old_slice_size + 2*new_slice_size.
+	 * ANALYSIS: one all-to-all, every process sends to and receives from O(1) processes when n > p.
+	 * 			 Amount of sent/received data is O(n^2/p), no temporary memory besides the new slice.
 	 */
-	/** FIXME: PROFILING? You'll know better **/
-	void reassign_graph(MPI_Comm comm, int p2, Graph *pGraph, int x, MPI_Comm *newComm) {
-
-		Graph& graph = *pGraph;
-		int w, n, w2, n2, size;
-		char *sendApplicationBuffer;
-		int sendSizeSlice, sendBuffSize;
-		bool secondSending = false;
-		bool *reception;
-		int nSenders;
-		MPI_Request *request;
-		MPI_Request request1, request2;
-		MPI_Datatype blockType, oldType = MPI_LONG; //rowType is the MPI type defining what to send (the partially unpadded row).
+	template <typename T>
+	void reassign_graph(MPI_Comm comm, int p2, graph_slice<T> *pGraph, int x, rc_workspace<T> * workspace) {
+
+		graph_slice<T>& graph = *pGraph;
+		MPI_Datatype type = MPIDatatype<T>::constructType();
 
 		int p;
 		MPI_Comm_size(comm, &p);
@@ -385,127 +323,74 @@ namespace mincut {
 		int rank; //The rank of the current processor in the communicator.
 		MPI_Comm_rank(comm, &rank);
 
-		w = graph.get_rows_per_slice();
-		n = w*p;
-		w2 = (int) ceil( ((double) x)/(double (p2)) );
-		n2 = w2*p2;
-		size = ((int) floor( ((double) w2)/(double (w)) )) + 2; //A receiver can receive from at most size processes.
-		nSenders = (int) ceil( ((double) n2)/(double (w)) );
-
-		reception = new bool[size](); //Initialize to false.
-		request = new MPI_Request[size];
-
-		int position = rank*w;
-		if(rank < nSenders) { //Senders.
-			int nRows, dest;
-			long *toSend = graph.begin(); //It points to what is going to be sent.
-			//MPI_Type_vector(w+1, n2, n, oldType, &blockType); //Type for the whole slice.
-			MPI_Pack_size(w*n2, oldType, comm, &sendSizeSlice); //Size for the whole slice part to be sent.
-			sendBuffSize = sendSizeSlice + 2*MPI_BSEND_OVERHEAD; //Max size of buffer, considering 2 max sends.
-			sendApplicationBuffer = new char[sendBuffSize]; //Buffer (in bytes).
-			MPI_Buffer_attach(sendApplicationBuffer, sendBuffSize);
-			//MPI_Type_free(&blockType);
-
-			dest = (int) floor( ((double) position)/(double (w2)) );
-			nRows = w2 - (position % w2);
-
-			if(nRows < w && (dest + 1) < p2) {//Send to two processes.
-				secondSending = true;
-
-
-				// Do we do this a lot? Basically log(size of dense group)?
-				// These are collectives, may be worth optimizing
-				MPI::Type_vector(nRows, n2, n, oldType, &blockType); //Re-define the type for the partially unpadded row.
-				MPI::Type_commit(&blockType);
-				MPI::Ibsend(toSend, 1, blockType, dest, SLICETAG, comm, &request1);
-				MPI::Type_free(&blockType);
-
-				dest++; //Move to the next destination. It can send to at most 2 processes.
-				toSend += nRows*n; //Advance the pointer.
-				nRows = w - nRows;
-				MPI::Type_vector(nRows, n2, n, oldType, &blockType); //Re-define the type for the partially unpadded row.
-				MPI::Type_commit(&blockType);
-				MPI::Ibsend(toSend, 1, blockType, dest, SLICETAG, comm, &request2);
-				MPI::Type_free(&blockType);
-			}
-			else {//Send just to one.
-				if(nRows > w) nRows = w; //This process has to send all of his locally stored graph.
-
-				MPI::Type_vector(nRows, n2, n, oldType, &blockType); //Re-define the type for the partially unpadded row.
-				MPI::Type_commit(&blockType);
-				MPI::Ibsend(toSend, 1, blockType, dest, SLICETAG, comm, &request1);
-				MPI::Type_free(&blockType);
-			}
-		}
+		long w = graph.get_rows_per_slice();
+		long n = graph.get_size();
+		long w2 = (long) ceil( ((double) x)/(double (p2)) );
+		long n2 = w2*p2;
 
-		if(rank < p2) { //Receivers.
-			int source, nRows;
-			long *slice_memory = new long[n2*w2];
-			long *toReceive = slice_memory; ////It points to where the incoming data's going to be stored.
+		assert (n2 <= n);
 
-			source = (int) floor( ((double) rank*w2)/(double (w)) );
-			if(rank*w2 % w == 0) nRows = w2 - (source*w % w2);
-			else nRows = w - (w2 - (source*w % w2));
-			reception[0] = true;
+		//The rows past n2 are padding and are dropped
+		long first = rank*w;
+		long rows = std::max(0L, std::min(w, n2 - first));
 
+		T *rowData = graph.begin();
+		for (long i = 1; i < rows; ++i) {
+			std::copy(rowData + i*n, rowData + i*n + n2, rowData + i*n2);
+		}
 
-			for(int i = 0; i < size && source < nSenders; i++) {
-				if(nRows <= w && i != 0) {
-					MPI::Irecv(toReceive, nRows*n2, oldType, source, SLICETAG, comm, request + i);
-					break;
-				}
-				else {
-					if(source + 1 < nSenders) reception[i + 1] = true;
-					if(i == 0) {
-						if(nRows > w) nRows = w;
-					} else nRows = w;
+		std::vector<size_t> sendCounts(p, 0), sendDispls(p, 0), recvCounts(p, 0), recvDispls(p, 0);
 
-					MPI::Irecv(toReceive, nRows*n2, oldType, source, SLICETAG, comm, request + i);
+		for (long row = first; row < first + rows; ) {
+			long dest = row/w2;
+			long end = std::min((dest + 1)*w2, first + rows);
+			sendCounts[dest] = (end - row)*n2;
+			sendDispls[dest] = (row - first)*n2;
+			row = end;
+		}
 
-					source++; //Update source.
-					toReceive += nRows*n2; //Advance the pointer.
-					nRows = w2 - (source*w % w2);
-				}
-			}
+		graph_slice<T> newSlice;
 
-			//Wait for data to be sent.
-			MPI::Wait(&request1, MPI_STATUS_IGNORE);
-			if(secondSending) MPI::Wait(&request2, MPI_STATUS_IGNORE);
+		if (rank < p2) { //Receivers.
+			newSlice = workspace
+					? workspace->slice_after(rowData, x, (int) w2, rank, (int) n2)
+					: graph_slice<T>(x, (int) w2, rank, (int) n2, new T[n2*w2]);
 
-			//Wait for data to be arrived.
-			for(int z = 0; z < size; z++) {
-				if(reception[z]) MPI::Wait(request + z, MPI_STATUS_IGNORE);
-				else break;
+			for (long row = rank*w2; row < (rank + 1)*w2; ) {
+				long source = row/w;
+				long end = std::min((source + 1)*w, (rank + 1)*w2);
+				recvCounts[source] = (end - row)*n2;
+				recvDispls[source] = (row - rank*w2)*n2;
+				row = end;
 			}
+		}
 
-			Graph newSlice (x, w2, rank, n2, slice_memory);
-			*pGraph = newSlice;
-
-			MPI_Comm_split(comm, 0, 0, newComm);
+		MPI::Alltoallv_large(rowData, sendCounts.data(), sendDispls.data(),
+							 newSlice.begin(), recvCounts.data(), recvDispls.data(), type, comm);
 
+		if (rank < p2) {
+			*pGraph = newSlice;
 		}
 		else {
-			//Wait for data to be sent.
-			if (rank < nSenders) {
-				MPI::Wait(&request1, MPI_STATUS_IGNORE);
-				if(secondSending) MPI::Wait(&request2, MPI_STATUS_IGNORE);
-				//graph.free_slice(); //This will be freed in recursive_contract through assigments.
-			}
-
-			MPI_Comm_split(comm, 1, 0, newComm);
-		}
-
-		MPI::Barrier(comm);
-
-		if (rank < nSenders) {
-			MPI_Buffer_detach(sendApplicationBuffer, &sendBuffSize);
-			delete[] sendApplicationBuffer;
+			graph.free_slice();
 		}
-
-		delete[] reception;
-		delete[] request;
-
-		return;
 	}
 
+	////
+	//Instantiations for the supported weight types
+	////
+
+	template long parallel_cut<int>(MPI_Comm, graph_slice<int>&, int, int);
+	template long parallel_cut<long>(MPI_Comm, graph_slice<long>&, int, int);
+	template long parallel_cut<int>(const comm_tree &, graph_slice<int>&, int, int);
+	template long parallel_cut<long>(const comm_tree &, graph_slice<long>&, int, int);
+	template long parallel_cut<int>(MPI_Comm, graph_slice<int>&, double, int);
+	template long parallel_cut<long>(MPI_Comm, graph_slice<long>&, double, int);
+	template long parallel_recursive_contract<int>(const comm_tree &, int, graph_slice<int>&, sitmo::prng_engine *, rc_workspace<int> *);
+	template long parallel_recursive_contract<long>(const comm_tree &, int, graph_slice<long>&, sitmo::prng_engine *, rc_workspace<long> *);
+	template graph_slice<int> duplicate_graph<int>(MPI_Comm, graph_slice<int> *, rc_workspace<int> *);
+	template graph_slice<long> duplicate_graph<long>(MPI_Comm, graph_slice<long> *, rc_workspace<long> *);
+	template void reassign_graph<int>(MPI_Comm, int, graph_slice<int> *, int, rc_workspace<int> *);
+	template void reassign_graph<long>(MPI_Comm, int, graph_slice<long> *, int, rc_workspace<long> *);
+
 }
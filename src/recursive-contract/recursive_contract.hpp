@@ -11,23 +11,47 @@
 #include <cmath>
 #include <limits>
 #include "mpi.h"
+#include "comm_tree.hpp"
+#include "rc_workspace.hpp"
 
 
-typedef graph_slice<long> Graph; //Use graphs with long weights.
+typedef graph_slice<long> Graph; //Use graphs with long weights, unless the weights are known to fit into an int.
 
 namespace mincut {
 
-	Graph duplicate_graph(MPI_Comm comm, int p, Graph *pGraph, MPI_Comm *newComm);
-	void reassign_graph(MPI_Comm comm, int p2, Graph *pGraph, int x, MPI_Comm *newComm);
+	//The recursive contraction is instantiated for int and long weights (T). The cuts are returned as long.
+
+	//Every level of the recursion contracts the graph to ceil(n/sqrt(2) + 1) vertices
+	inline int contraction_target(int vertices) {
+		return (int) ceil( ((double) vertices)/sqrt(2.0) + 1.0);
+	}
+
+	//The functions taking an rc_workspace place the slices they create in it (the previous slice is in the other
+	//buffer). Without a workspace, they allocate.
+
+	//The sender (rank 0 of pairComm) passes its slice, the receiver passes nullptr and gets the copy
+	template <typename T>
+	graph_slice<T> duplicate_graph(MPI_Comm pairComm, graph_slice<T> *pGraph, rc_workspace<T> * workspace = nullptr);
+	template <typename T>
+	void reassign_graph(MPI_Comm comm, int p2, graph_slice<T> *pGraph, int x, rc_workspace<T> * workspace = nullptr);
     
     
     long parallel_recursive_contract(MPI_Comm comm, Graph& graph);//deprecated, only use for basic testing
     
-    long parallel_recursive_contract(MPI_Comm comm, Graph& graph, sitmo::prng_engine * random);
+    //The graph is distributed on tree.group(level), the recursion continues on the deeper levels
+    template <typename T>
+    long parallel_recursive_contract(const comm_tree & tree, int level, graph_slice<T>& graph, sitmo::prng_engine * random,
+                                     rc_workspace<T> * workspace = nullptr);
+    
+    template <typename T>
+    long parallel_cut(MPI_Comm comm, graph_slice<T>& graph, int trials, int seed);
     
-    long parallel_cut(MPI_Comm comm, Graph& graph, int trials, int seed);
+    //Uses the communicators of a tree built by the caller, e.g. to share them across several cuts of the same group
+    template <typename T>
+    long parallel_cut(const comm_tree & tree, graph_slice<T>& graph, int trials, int seed);
     
-    long parallel_cut(MPI_Comm comm, Graph& graph, double min_success, int seed);
+    template <typename T>
+    long parallel_cut(MPI_Comm comm, graph_slice<T>& graph, double min_success, int seed);
 
     long distributed_parallel_cut(MPI_Comm comm, int totTrials, int seed, int V, std::string filename);
 
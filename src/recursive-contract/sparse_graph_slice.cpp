@@ -0,0 +1,62 @@
+//
+//  sparse_graph_slice.cpp
+//
+
+#include <cstddef>
+#include <numeric>
+#include "sparse_graph_slice.hpp"
+#include "MPICollector.hpp"
+#include "utils.hpp"
+
+MPI_Datatype create_weighted_edge_t() {
+    int block_lengths[3] = { 1, 1, 1 };
+    MPI_Aint displacements[3] = {
+        offsetof(weighted_edge_struct_t, v1),
+        offsetof(weighted_edge_struct_t, v2),
+        offsetof(weighted_edge_struct_t, weight)
+    };
+    MPI_Datatype types[3] = { MPI_INT, MPI_INT, MPI_LONG };
+
+    MPI_Datatype struct_t, weighted_edge_t;
+    MPI_Type_create_struct(3, block_lengths, displacements, types, &struct_t);
+    //the extent has to include the padding, so that arrays of the struct can be sent
+    MPI_Type_create_resized(struct_t, 0, sizeof(weighted_edge_struct_t), &weighted_edge_t);
+    MPI_Type_free(&struct_t);
+    MPI_Type_commit(&weighted_edge_t);
+
+    return weighted_edge_t;
+}
+
+std::vector<weighted_edge_struct_t> send_to_row_owners(MPI_Comm comm, std::vector<weighted_edge_struct_t> & entries, int rows_per_slice) {
+    int p;
+    MPI_Comm_size(comm, &p);
+
+    //bucket the entries by owner with a counting pass
+    std::vector<size_t> send_counts(p, 0);
+    for (auto const & entry : entries) {
+        send_counts[entry.v1 / rows_per_slice]++;
+    }
+
+    std::vector<size_t> send_displacements = MPIUtils::prefix_offsets(send_counts);
+    std::vector<weighted_edge_struct_t> outgoing(entries.size());
+    {
+        std::vector<size_t> next(send_displacements);
+        for (auto const & entry : entries) {
+            outgoing[next[entry.v1 / rows_per_slice]++] = entry;
+        }
+        std::vector<weighted_edge_struct_t>().swap(entries);
+    }
+
+    std::vector<size_t> recv_counts(p);
+    MPI::Alltoall(send_counts.data(), 1, MPI_SIZE_T, recv_counts.data(), 1, MPI_SIZE_T, comm);
+    std::vector<size_t> recv_displacements = MPIUtils::prefix_offsets(recv_counts);
+
+    std::vector<weighted_edge_struct_t> incoming(std::accumulate(recv_counts.begin(), recv_counts.end(), size_t(0)));
+
+    MPI_Datatype weighted_edge_t = create_weighted_edge_t();
+    MPI::Alltoallv_large(outgoing.data(), send_counts.data(), send_displacements.data(),
+                         incoming.data(), recv_counts.data(), recv_displacements.data(), weighted_edge_t, comm);
+    MPI_Type_free(&weighted_edge_t);
+
+    return incoming;
+}
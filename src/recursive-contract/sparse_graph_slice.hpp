@@ -0,0 +1,249 @@
+//
+//  sparse_graph_slice.hpp
+//
+//  Sparse counterpart of graph_slice: the same row distribution, but the rows are stored in CSR,
+//  so the memory is proportional to the number of edges rather than to n^2/p.
+//
+
+#ifndef sparse_graph_slice_h
+#define sparse_graph_slice_h
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+#include "prng_engine.hpp"
+#include "mpi.h"
+#include "graph_slice.hpp"
+
+//Used to transfer weighted adjacency matrix entries (one direction of an edge) between slices
+//We can't send classes over MPI, so we need plain old data
+//The MPI datatype for this is created by create_weighted_edge_t
+typedef struct {
+    int v1;
+    int v2;
+    long weight;
+} weighted_edge_struct_t;
+
+//The caller has to free the type
+MPI_Datatype create_weighted_edge_t();
+
+//Sends every entry to the processor owning its row, i.e. to v1 / rows_per_slice, and returns the entries this processor received
+//Consumes entries
+//Time: O(m) locally, where m is the number of entries
+std::vector<weighted_edge_struct_t> send_to_row_owners(MPI_Comm comm, std::vector<weighted_edge_struct_t> & entries, int rows_per_slice);
+
+
+//Represents a subset of the rows of an adjacency matrix of a graph in compressed sparse row format
+//The slice holds the rows [rank * rows_per_node, (rank + 1) * rows_per_node), rows past the last vertex are empty
+template <typename T>
+class sparse_graph_slice {
+
+    //total number of rows, columns in the graph
+    int number_of_vertices = 0;
+
+    //the slice has this many rows
+    int rows_per_node = 0;
+
+    //the first row of this slice corresponds to the (rank * rows_per_node)-th vertex in the graph
+    int rank = 0;
+
+    //row i has the entries [row_offsets[i], row_offsets[i + 1])
+    std::vector<long> row_offsets;
+    std::vector<int> columns;
+    std::vector<T> weights;
+
+public:
+
+    //Time: O(1)
+    sparse_graph_slice() : row_offsets(1, 0) {};
+
+    //Builds the slice from entries of its rows, in any order. Entries for the same position are summed, loops are dropped.
+    //Time: O(m log m), where m is the number of entries
+    sparse_graph_slice(int vertices, int rows_per_slice, int rank, std::vector<weighted_edge_struct_t> & entries);
+
+    //Time: O(1)
+    int get_number_of_vertices() const { return number_of_vertices; }
+
+    //Time: O(1)
+    void set_number_of_vertices(int v) { number_of_vertices = v; }
+
+    //Time: O(1)
+    int get_rows_per_slice() const { return rows_per_node; }
+
+    //Time: O(1)
+    int get_rank() const { return rank; }
+
+    //Global index of the first row
+    //Time: O(1)
+    int get_first_row() const { return rank * rows_per_node; }
+
+    //Number of stored entries, i.e. twice the number of edges incident to the rows
+    //Time: O(1)
+    long get_entry_count() const { return (long) columns.size(); }
+
+    //Time: O(1)
+    long row_begin(int i) const { return row_offsets[i]; }
+
+    //Time: O(1)
+    long row_end(int i) const { return row_offsets[i + 1]; }
+
+    //Time: O(1)
+    int get_column(long entry) const { return columns[entry]; }
+
+    //Time: O(1)
+    T get_weight(long entry) const { return weights[entry]; }
+
+    //returns the sum of the capacities of every vertex whose row is included in this slice
+    //Time: O(m)
+    T accumulate() const;
+
+    //Appends all entries of the slice in global coordinates
+    //Time: O(m)
+    void entries(std::vector<weighted_edge_struct_t> & out) const;
+
+    //Materializes the rows as a dense graph_slice with `size` columns (the caller frees it)
+    //Time: O(size k + m)
+    graph_slice<T> to_dense(int size) const;
+
+};
+
+
+//Prefix sums over the entries of a sparse slice, allowing to select random edges in logarithmic time per edge
+template <typename T>
+class sparse_graph_slice_index {
+
+    const sparse_graph_slice<T> * graph = nullptr;
+    std::vector<T> prefix_sums;
+
+public:
+
+    //Time: O(1)
+    sparse_graph_slice_index() {}
+
+    //Time: O(m)
+    explicit sparse_graph_slice_index(const sparse_graph_slice<T> * graph) { refresh(graph); }
+
+    //Indexes the given slice, reusing the memory of the previous one
+    //Time: O(m)
+    void refresh(const sparse_graph_slice<T> * graph);
+
+    //Sum of all weights in the slice
+    //Time: O(1)
+    T total() const { return prefix_sums.empty() ? T() : prefix_sums.back(); }
+
+    //Selects an edge in the slice with probability proportional to its weight
+    //Time: O(log m)
+    void select_random_edge(edge_struct_t * result, sitmo::prng_engine * random_engine) const;
+
+};
+
+
+////
+//IMPLEMENTATION :: sparse_graph_slice
+////
+
+template <typename T>
+sparse_graph_slice<T>::sparse_graph_slice(int vertices, int rows_per_slice, int rank, std::vector<weighted_edge_struct_t> & entries) :
+        number_of_vertices(vertices), rows_per_node(rows_per_slice), rank(rank), row_offsets(rows_per_slice + 1, 0) {
+
+    std::sort(entries.begin(), entries.end(), [](weighted_edge_struct_t const & a, weighted_edge_struct_t const & b) {
+        return a.v1 < b.v1 || (a.v1 == b.v1 && a.v2 < b.v2);
+    });
+
+    int first_row = get_first_row();
+    int last_row = -1;
+
+    for (auto const & entry : entries) {
+        assert (entry.v1 >= first_row && entry.v1 < first_row + rows_per_node);
+
+        if (entry.v1 == entry.v2 || entry.weight == 0) {
+            continue;
+        }
+
+        int row = entry.v1 - first_row;
+        if (row == last_row && columns.back() == entry.v2) {
+            weights.back() += entry.weight;
+        } else {
+            columns.push_back(entry.v2);
+            weights.push_back(entry.weight);
+            last_row = row;
+        }
+        row_offsets[row + 1] = (long) columns.size();
+    }
+
+    //rows without entries end where the previous row ended
+    for (int i = 1; i <= rows_per_node; ++i) {
+        row_offsets[i] = std::max(row_offsets[i], row_offsets[i - 1]);
+    }
+}
+
+template <typename T>
+T sparse_graph_slice<T>::accumulate() const {
+    return std::accumulate(weights.begin(), weights.end(), T());
+}
+
+template <typename T>
+void sparse_graph_slice<T>::entries(std::vector<weighted_edge_struct_t> & out) const {
+    int first_row = get_first_row();
+    for (int i = 0; i < rows_per_node; ++i) {
+        for (long j = row_begin(i); j < row_end(i); ++j) {
+            out.push_back({ first_row + i, columns[j], weights[j] });
+        }
+    }
+}
+
+template <typename T>
+graph_slice<T> sparse_graph_slice<T>::to_dense(int size) const {
+    T * data = new T[(long) size * rows_per_node];
+    std::fill(data, data + (long) size * rows_per_node, T());
+
+    for (int i = 0; i < rows_per_node; ++i) {
+        for (long j = row_begin(i); j < row_end(i); ++j) {
+            data[(long) i * size + columns[j]] = weights[j];
+        }
+    }
+
+    return graph_slice<T>(number_of_vertices, rows_per_node, rank, size, data);
+}
+
+////
+//IMPLEMENTATION :: sparse_graph_slice_index
+////
+
+template <typename T>
+void sparse_graph_slice_index<T>::refresh(const sparse_graph_slice<T> * graph) {
+    this->graph = graph;
+    prefix_sums.resize(graph->get_entry_count());
+    T sum = T();
+    for (long j = 0; j < graph->get_entry_count(); ++j) {
+        sum += graph->get_weight(j);
+        prefix_sums[j] = sum;
+    }
+}
+
+template <typename T>
+void sparse_graph_slice_index<T>::select_random_edge(edge_struct_t * result, sitmo::prng_engine * random_engine) const {
+    assert (!prefix_sums.empty());
+
+    std::uniform_int_distribution<T> uniform(1, prefix_sums.back());
+
+    long entry = std::lower_bound(prefix_sums.begin(), prefix_sums.end(), uniform(*random_engine)) - prefix_sums.begin();
+
+    //the row is the last one that starts at or before the entry (skipping empty rows)
+    int row = 0, last = graph->get_rows_per_slice() - 1;
+    while (row < last) {
+        int middle = (row + last + 1) / 2;
+        if (graph->row_begin(middle) <= entry) {
+            row = middle;
+        } else {
+            last = middle - 1;
+        }
+    }
+
+    result->v1 = graph->get_first_row() + row;
+    result->v2 = graph->get_column(entry);
+}
+
+#endif /* sparse_graph_slice_h */
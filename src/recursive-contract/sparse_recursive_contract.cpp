@@ -0,0 +1,205 @@
+//
+//  sparse_recursive_contract.cpp
+//
+
+#include <cmath>
+#include <limits>
+#include "sparse_recursive_contract.hpp"
+#include "recursive_contract.hpp"
+#include "parallel_contract.hpp"
+#include "co_mincut.h"
+#include "MPICollector.hpp"
+#include "utils.hpp"
+
+namespace mincut {
+
+    template <typename T>
+    long parallel_cut(MPI_Comm comm, sparse_graph_slice<T>& graph, int trials, int seed) {
+        comm_tree tree(comm);
+        return parallel_cut(tree, graph, trials, seed);
+    }
+
+    //Every trial runs on its own copy of the graph and on the same communicators, the root receives the smallest cut
+    template <typename T>
+    long parallel_cut(const comm_tree & tree, sparse_graph_slice<T>& graph, int trials, int seed) {
+        long cut = std::numeric_limits<long>::max();
+        int rank;
+        MPI_Comm comm = tree.group(0);
+
+        MPI_Comm_rank(comm, &rank);
+
+        sitmo::prng_engine random(rank+seed);
+
+        //The relabeling and the index of all the contraction tries of all the trials
+        rc_workspace<T> workspace(0, graph.get_number_of_vertices());
+
+        for (int i=0; i<trials; ++i) {
+            sparse_graph_slice<T> copied_graph = graph;
+            cut = std::min(cut, parallel_recursive_contract(tree, 0, copied_graph, &random, &workspace));
+        }
+
+        long cut_result = cut;
+        MPI::Reduce(&cut, &cut_result, 1, MPI_LONG, MPI_MIN, 0, comm);
+
+        return cut_result;
+    }
+
+    //Same recursion as for graph_slice. Before every level, the density of the remaining graph is checked:
+    //once the contracted graph is dense enough, the slices are materialized and the dense recursion takes over
+    //on the same level of the tree.
+    //Time: O(log(p) * (m/p log m + parallel_contract)) while sparse
+    template <typename T>
+    long parallel_recursive_contract(const comm_tree & tree, int level, sparse_graph_slice<T>& graph, sitmo::prng_engine * random,
+                                     rc_workspace<T> * workspace) {
+        int V, p, rank, x, p2;
+        long cut;
+        MPI_Comm superComm;
+
+        superComm = tree.group(level);
+        MPI_Comm_size(superComm, &p);
+        MPI_Comm_rank(superComm, &rank);
+
+        int world_rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+        while (p > 1) {
+            V = graph.get_number_of_vertices();
+
+            long entries = graph.get_entry_count(), total_entries;
+            MPI::Allreduce(&entries, &total_entries, 1, MPI_LONG, MPI_SUM, superComm);
+
+            if (total_entries == 0) { //Disconnected, and there is nothing left to sample
+                graph = sparse_graph_slice<T>();
+                return 0;
+            }
+
+            if (total_entries >= dense_switch_density * V * (double) V) {
+                graph_slice<T> dense = graph.to_dense(graph.get_rows_per_slice() * p);
+                graph = sparse_graph_slice<T>();
+
+                DebugUtils::print(rank, [&](std::ostream & out) {
+                    out << "switching to dense slices at " << V << " vertices, " << total_entries << " entries";
+                });
+
+                return parallel_recursive_contract(tree, level, dense, random);
+            }
+
+            x = contraction_target(V); //Contract to ceil(n/sqrt(2) + 1).
+            p2 = p/2; //p is a power of two.
+
+            std::string tag = "rc.sparse.level" + std::to_string(level);
+
+            TimeUtils::profileStep([&]() {
+                parallel_contract(superComm, &graph, random, x, workspace);
+            }, world_rank, tag + ".contract");
+
+            assert(graph.get_number_of_vertices() == x);
+
+            TimeUtils::profileStep([&]() {
+                reassign_graph(superComm, p2, &graph, x);
+            }, world_rank, tag + ".reassign");
+
+            TimeUtils::profileStep([&]() {
+                if(rank < p2) duplicate_graph(tree.pair(level), &graph);
+                else graph = duplicate_graph(tree.pair(level), static_cast<sparse_graph_slice<T> *>(nullptr));
+            }, world_rank, tag + ".duplicate");
+
+            superComm = tree.group(++level);
+            MPI_Comm_size(superComm, &p);
+            assert (p == p2);
+            MPI_Comm_rank(superComm, &rank);
+        }
+
+        //serial_contract
+        assert(graph.get_rows_per_slice() == graph.get_number_of_vertices());
+
+        graph_slice<T> dense = graph.to_dense(graph.get_number_of_vertices());
+        graph = sparse_graph_slice<T>();
+
+        adjacency_matrix<T> matrix(dense.get_number_of_vertices(), dense.begin());
+
+        cut = comincut::minimum_cut_try(&matrix, (*random)());
+
+        dense.free_slice();
+
+        return cut;
+    }
+
+    //The sender broadcasts the shape and the entries of its slice within the pair, the receiver rebuilds the CSR
+    //ANALYSIS: O(1) communications per processor. Sent/received data = O(m/p)
+    template <typename T>
+    sparse_graph_slice<T> duplicate_graph(MPI_Comm pairComm, sparse_graph_slice<T> *pGraph) {
+
+        int rank;
+        MPI_Comm_rank(pairComm, &rank);
+
+        assert ((rank == 0) == (pGraph != nullptr));
+
+        MPI_Datatype weighted_edge_t = create_weighted_edge_t();
+
+        std::vector<weighted_edge_struct_t> entries;
+        long info[4];
+
+        if (rank == 0) {
+            entries.reserve(pGraph->get_entry_count());
+            pGraph->entries(entries);
+
+            info[0] = pGraph->get_rows_per_slice();
+            info[1] = pGraph->get_number_of_vertices();
+            info[2] = (long) entries.size();
+            info[3] = pGraph->get_rank();
+        }
+
+        MPI::Bcast(info, 4, MPI_LONG, 0, pairComm);
+
+        entries.resize(info[2]);
+        MPI::Bcast_large(entries.data(), entries.size(), weighted_edge_t, 0, pairComm);
+
+        MPI_Type_free(&weighted_edge_t);
+
+        if (rank == 0) { //Sender processor.
+            return *pGraph;
+        }
+        else { //Receiver processor.
+            return sparse_graph_slice<T>((int) info[1], (int) info[0], (int) info[3], entries);
+        }
+    }
+
+    //Every entry goes to the owner of its row among the first p2 processors, the others are left with an empty slice
+    //ANALYSIS: one all-to-all. Sent/received data = O(m/p)
+    template <typename T>
+    void reassign_graph(MPI_Comm comm, int p2, sparse_graph_slice<T> *pGraph, int x) {
+
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+
+        int w2 = (int) ceil( ((double) x)/(double (p2)) );
+
+        std::vector<weighted_edge_struct_t> entries;
+        entries.reserve(pGraph->get_entry_count());
+        pGraph->entries(entries);
+        *pGraph = sparse_graph_slice<T>();
+
+        std::vector<weighted_edge_struct_t> incoming = send_to_row_owners(comm, entries, w2);
+
+        if (rank < p2) {
+            *pGraph = sparse_graph_slice<T>(x, w2, rank, incoming);
+        }
+    }
+
+    ////
+    //Instantiations for the supported weight types
+    ////
+
+    template long parallel_cut<int>(MPI_Comm, sparse_graph_slice<int>&, int, int);
+    template long parallel_cut<long>(MPI_Comm, sparse_graph_slice<long>&, int, int);
+    template long parallel_cut<int>(const comm_tree &, sparse_graph_slice<int>&, int, int);
+    template long parallel_cut<long>(const comm_tree &, sparse_graph_slice<long>&, int, int);
+    template long parallel_recursive_contract<int>(const comm_tree &, int, sparse_graph_slice<int>&, sitmo::prng_engine *, rc_workspace<int> *);
+    template long parallel_recursive_contract<long>(const comm_tree &, int, sparse_graph_slice<long>&, sitmo::prng_engine *, rc_workspace<long> *);
+    template sparse_graph_slice<int> duplicate_graph<int>(MPI_Comm, sparse_graph_slice<int> *);
+    template sparse_graph_slice<long> duplicate_graph<long>(MPI_Comm, sparse_graph_slice<long> *);
+    template void reassign_graph<int>(MPI_Comm, int, sparse_graph_slice<int> *, int);
+    template void reassign_graph<long>(MPI_Comm, int, sparse_graph_slice<long> *, int);
+
+}
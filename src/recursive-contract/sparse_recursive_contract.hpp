@@ -0,0 +1,46 @@
+//
+//  sparse_recursive_contract.hpp
+//
+//  Recursive contraction on sparse_graph_slice. The graph stays in CSR while it is sparse, so the memory
+//  is proportional to the number of edges. Once the contracted graph gets dense, it continues on graph_slice.
+//
+
+#ifndef sparse_recursive_contract_hpp
+#define sparse_recursive_contract_hpp
+
+#include "mpi.h"
+#include "prng_engine.hpp"
+#include "graph_slice.hpp"
+#include "sparse_graph_slice.hpp"
+#include "comm_tree.hpp"
+#include "rc_workspace.hpp"
+
+namespace mincut {
+
+    //A level switches to the dense representation when at least this fraction of the adjacency matrix is nonzero
+    //(a CSR entry takes 12 bytes and the dense kernels are faster, so this is well below 1)
+    const double dense_switch_density = 0.25;
+
+    //Same contract as for graph_slice: the sender (rank 0 of pairComm) passes its slice, the receiver passes nullptr
+    template <typename T>
+    sparse_graph_slice<T> duplicate_graph(MPI_Comm pairComm, sparse_graph_slice<T> *pGraph);
+
+    //Redistributes the x remaining vertices on the first p2 processors, ceil(x/p2) rows each
+    template <typename T>
+    void reassign_graph(MPI_Comm comm, int p2, sparse_graph_slice<T> *pGraph, int x);
+
+    //Instantiated for int and long weights, like the dense version
+    //The contraction tries take their scratch space from the workspace, if there is one
+    template <typename T>
+    long parallel_recursive_contract(const comm_tree & tree, int level, sparse_graph_slice<T>& graph, sitmo::prng_engine * random,
+                                     rc_workspace<T> * workspace = nullptr);
+
+    template <typename T>
+    long parallel_cut(MPI_Comm comm, sparse_graph_slice<T>& graph, int trials, int seed);
+
+    template <typename T>
+    long parallel_cut(const comm_tree & tree, sparse_graph_slice<T>& graph, int trials, int seed);
+
+}
+
+#endif /* sparse_recursive_contract_hpp */
@@ -0,0 +1,83 @@
+#ifndef PARALLEL_MINIMUM_CUT_MULTIWAYMERGE_HPP
+#define PARALLEL_MINIMUM_CUT_MULTIWAYMERGE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+
+/**
+ * Merges k consecutive sorted runs with a loser tree, O(n log k) comparisons.
+ *
+ * @param data The runs, back to back
+ * @param run_offsets Where each run starts in `data` (the last one ends at data.size()), e.g. the displacements
+ *        of an all-to-all
+ * @return The merged elements
+ */
+template <typename ElementType>
+std::vector<ElementType> multiway_merge(std::vector<ElementType> const & data, std::vector<size_t> const & run_offsets) {
+	size_t k = run_offsets.size();
+	std::vector<ElementType> merged;
+	merged.reserve(data.size());
+
+	if (k <= 1) {
+		merged = data;
+		return merged;
+	}
+
+	if (k == 2) {
+		std::merge(data.begin(), data.begin() + run_offsets[1], data.begin() + run_offsets[1], data.end(), std::back_inserter(merged));
+		return merged;
+	}
+
+	std::vector<size_t> position(run_offsets), end(k);
+	for (size_t run = 0; run < k; run++) {
+		end[run] = run + 1 < k ? run_offsets[run + 1] : data.size();
+	}
+
+	// Exhausted runs and padding leaves compare as infinity
+	auto smaller = [&](size_t a, size_t b) {
+		if (a >= k || position[a] == end[a]) return false;
+		if (b >= k || position[b] == end[b]) return true;
+		return data[position[a]] < data[position[b]];
+	};
+
+	size_t leaves = 1;
+	while (leaves < k) {
+		leaves *= 2;
+	}
+
+	/** tree[node] is the loser of the match at `node`, the leaves are implicit */
+	std::vector<size_t> tree(leaves);
+
+	std::function<size_t(size_t)> play = [&](size_t node) -> size_t {
+		if (node >= leaves) {
+			return node - leaves;
+		}
+		size_t left = play(2 * node), right = play(2 * node + 1);
+		if (smaller(right, left)) {
+			tree[node] = left;
+			return right;
+		} else {
+			tree[node] = right;
+			return left;
+		}
+	};
+
+	size_t winner = play(1);
+
+	for (size_t i = 0; i < data.size(); i++) {
+		merged.push_back(data[position[winner]++]);
+
+		// Replay the path from the winner's leaf
+		for (size_t node = (winner + leaves) / 2; node >= 1; node /= 2) {
+			if (smaller(tree[node], winner)) {
+				std::swap(tree[node], winner);
+			}
+		}
+	}
+
+	return merged; // NRVO
+}
+
+#endif //PARALLEL_MINIMUM_CUT_MULTIWAYMERGE_HPP
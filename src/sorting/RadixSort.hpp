@@ -0,0 +1,111 @@
+#ifndef PARALLEL_MINIMUM_CUT_RADIXSORT_HPP
+#define PARALLEL_MINIMUM_CUT_RADIXSORT_HPP
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include "AdjacencyListGraph.hpp"
+#include "UnweightedGraph.hpp"
+
+/**
+ * Trait container to allow external implementation for any type. Types with a specialization are sorted by
+ * `radix_sort` using the 64-bit key, everything else falls back to `std::sort`.
+ *
+ * The key has to be order-preserving: `a < b` iff `key(a) < key(b)`.
+ */
+template <typename ElementType>
+struct RadixKey {
+	static constexpr bool enabled = false;
+};
+
+template <>
+struct RadixKey<AdjacencyListGraph::Edge> {
+	static constexpr bool enabled = true;
+
+	static uint64_t key(AdjacencyListGraph::Edge const & edge) {
+		return (uint64_t(edge.from) << 32) | edge.to;
+	}
+};
+
+template <>
+struct RadixKey<UnweightedGraph::Edge> {
+	static constexpr bool enabled = true;
+
+	static uint64_t key(UnweightedGraph::Edge const & edge) {
+		return (uint64_t(edge.from) << 32) | edge.to;
+	}
+};
+
+namespace radix_sort_detail {
+	/** Below this, the histogram passes do not pay off */
+	const size_t threshold = 256;
+	const unsigned digit_bits = 8, digits = 64 / digit_bits, radix = 1 << digit_bits;
+
+	template <typename ElementType>
+	void sort(std::vector<ElementType> & data) {
+		typedef RadixKey<ElementType> Key;
+
+		// All histograms in a single pass
+		std::vector<std::array<size_t, radix>> histograms(digits);
+		for (auto & histogram : histograms) {
+			histogram.fill(0);
+		}
+		for (auto const & element : data) {
+			uint64_t key = Key::key(element);
+			for (unsigned digit = 0; digit < digits; digit++) {
+				histograms[digit][(key >> (digit * digit_bits)) & (radix - 1)]++;
+			}
+		}
+
+		std::vector<ElementType> buffer(data.size());
+		ElementType * source = data.data(), * target = buffer.data();
+
+		for (unsigned digit = 0; digit < digits; digit++) {
+			auto & histogram = histograms[digit];
+
+			// Vertex ids are small, so most of the high digits are the same for all keys
+			if (std::find(histogram.begin(), histogram.end(), data.size()) != histogram.end()) {
+				continue;
+			}
+
+			size_t offset = 0;
+			for (auto & bucket : histogram) {
+				size_t count = bucket;
+				bucket = offset;
+				offset += count;
+			}
+
+			unsigned shift = digit * digit_bits;
+			for (size_t i = 0; i < data.size(); i++) {
+				target[histogram[(Key::key(source[i]) >> shift) & (radix - 1)]++] = source[i];
+			}
+
+			std::swap(source, target);
+		}
+
+		if (source != data.data()) {
+			data.swap(buffer);
+		}
+	}
+}
+
+/**
+ * Sorts `data` by `operator<`. Elements with a `RadixKey` are sorted by a (stable) LSD radix sort on their
+ * packed key, skipping the digits that are equal for all elements. The rest of the element is carried along.
+ */
+template <typename ElementType>
+typename std::enable_if<RadixKey<ElementType>::enabled>::type radix_sort(std::vector<ElementType> & data) {
+	if (data.size() < radix_sort_detail::threshold) {
+		std::sort(data.begin(), data.end());
+	} else {
+		radix_sort_detail::sort(data);
+	}
+}
+
+template <typename ElementType>
+typename std::enable_if<!RadixKey<ElementType>::enabled>::type radix_sort(std::vector<ElementType> & data) {
+	std::sort(data.begin(), data.end());
+}
+
+#endif //PARALLEL_MINIMUM_CUT_RADIXSORT_HPP
@@ -2,34 +2,82 @@
 #define PARALLEL_MINIMUM_CUT_SAMPLINGSORTER_HPP
 
 #include "mpi.h"
-#include "../../lib/prng_engine.hpp"
 #include <vector>
 #include <cmath>
-#include <random>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <tuple>
+#include <numeric>
 #include "MPIDatatype.hpp"
 #include "utils.hpp"
 #include "MPICollector.hpp"
+#include "RadixSort.hpp"
+#include "MultiwayMerge.hpp"
 
+/**
+ * The choice of SamplingSorter's algorithm, shared by all element types
+ */
+class SamplingSorterBase {
+public:
+	enum Algorithm {
+		/** Multi-level from `multi_level_threshold_` processors on */
+		AUTO,
+		SINGLE_LEVEL,
+		MULTI_LEVEL
+	};
+};
+
+/**
+ * Distributed sort by regular sampling.
+ *
+ * Small communicators sort in a single level. From `multi_level_threshold_` processors on, the sort recurses
+ * on groups of processors instead (see `sortMultiLevel`).
+ *
+ * Every element is implicitly tagged with (rank, index in the sorted local data), which makes all the elements
+ * distinct. The splitters are compared on the tagged elements, so a long run of equal elements can be split among
+ * several processors and no processor receives much more than n/p elements (see `oversampling_`), regardless of
+ * duplicates.
+ */
 template <typename ElementType>
-class SamplingSorter {
+class SamplingSorter : public SamplingSorterBase {
+private:
+	/** An element with its tie-breaking secondary key */
+	struct Tagged {
+		ElementType element;
+		int rank;
+		size_t index;
+
+		bool operator<(Tagged const & other) const {
+			if (element < other.element) return true;
+			if (other.element < element) return false;
+			return std::tie(rank, index) < std::tie(other.rank, other.index);
+		}
+	};
+
 	MPI_Comm communicator_;
 	int p_, rank_;
 	MPI_Datatype element_type_;
 	std::vector<ElementType> data_;
-	sitmo::prng_engine random_engine_;
-
-
+	/**
+	 * Samples taken by every processor, as a multiple of the number of parts. A slice exceeds the average by at
+	 * most about 1 / oversampling_ of it (per level)
+	 */
+	const unsigned oversampling_ = 8;
+	double imbalance_ = 0;
+	Algorithm algorithm_ = AUTO;
+	/** Communicator size from which on AUTO sorts in multiple levels */
+	const int multi_level_threshold_ = 256;
+	/** Multi-level communicators of at most this size finish in a single level */
+	const unsigned base_case_processors_ = 16;
 
 public:
 	/**
 	 * The communicator ownership is 'transfered' to the sorter until all members have performed `sort`
 	 */
-	SamplingSorter(MPI_Comm communicator, std::vector<ElementType> && data, int32_t seed_with_offset) :
+	SamplingSorter(MPI_Comm communicator, std::vector<ElementType> && data) :
 			communicator_(communicator),
-			data_(data),
-			random_engine_(seed_with_offset)
+			data_(std::move(data))
 	{
 		MPI_Comm_size(communicator_, &p_);
 		MPI_Comm_rank(communicator_, &rank_);
@@ -38,134 +86,83 @@ public:
 
 	/**
 	 * Execute the sort.
-	 * Note: all sizes are communicated as integers for simplicity (size_t is platform-specific)
-	 * TODO: possibly use unsigneds or define the mapping
+	 * Note: all sizes are size_t (communicated as MPI_SIZE_T), so neither the global nor the per-processor
+	 * counts are limited to 2^31 elements
 	 */
 	std::vector<ElementType> sort() {
-		/*
-		 * ======== Exchange metadata ========
-		 */
-		/** Total size */
-		int n, local_elements = data_.size();
-		MPI::Allreduce(&local_elements, &n, 1, MPI_INT, MPI_SUM, communicator_);
+		bool multi_level = algorithm_ == MULTI_LEVEL || (algorithm_ == AUTO && p_ >= multi_level_threshold_);
+		return multi_level ? sortMultiLevel() : sortSingleLevel();
+	}
 
-		/*
-		 * ======== Sample locally ========
-		 */
-		double sampling_probability = std::pow(double(n), -0.5);
-		std::uniform_real_distribution<double> distribution(0, 1);
+	/**
+	 * @return The largest slice after the last `sort` relative to the average slice size (1 is perfect balance)
+	 */
+	double imbalance() const {
+		return imbalance_;
+	}
 
-		std::vector<ElementType> local_samples;
-		for (auto const & element : data_) {
-			if (distribution(random_engine_) <= sampling_probability) {
-				local_samples.push_back(element);
-			}
-		}
+	void setAlgorithm(Algorithm algorithm) {
+		algorithm_ = algorithm;
+	}
 
+protected:
+	/**
+	 * One round of sampling and a single all-to-all exchange among all p processors
+	 */
+	std::vector<ElementType> sortSingleLevel() {
 		/*
-		 * ======== Communicate samples ========
+		 * ======== Sort locally ========
 		 */
-		// Communicate all sample sizes, we will need a non-uniform all-gather
-		int local_sample_size = local_samples.size();
-		std::vector<int> sample_sizes(p_);
-		MPI::Allgather(&local_sample_size, 1, MPI_INT, sample_sizes.data(), 1, MPI_INT, communicator_);
-
-		std::vector<int> samples_offsets = MPIUtils::prefix_offsets(sample_sizes);
-		int total_sample_size = samples_offsets.back() + sample_sizes.back();
-
-		/** Global samples to be gathered */
-		std::vector<ElementType> samples(total_sample_size);
-
-		MPI::Allgatherv(
-				local_samples.data(),
-				local_sample_size,
-				element_type_,
-				samples.data(),
-				sample_sizes.data(),
-				samples_offsets.data(),
-				element_type_,
-				communicator_
-		);
+		radix_sort(data_);
 
 		/*
-		 * ======== Sort and partition elements ========
-		 */
-		std::sort(samples.begin(), samples.end());
-		std::sort(data_.begin(), data_.end());
-
-		/** Number of samples per processor */
-		int k = total_sample_size / p_;
-		/**
-		 * Select pivots P_1, ..., P_{p - 1} for division among processors.
-		 * p_1 will get all edges e | e < P_1
-		 * p_2 will get all edges e | P_1 <= e < P_2
-		 * ...
-		 * p_p will get all edges e | P_{p - 1} <= e
-		 * Note that C++ orders are defined by `operator<`
+		 * ======== Select splitters ========
 		 */
-		std::vector<ElementType> pivots;
-		for (int i { 1 }; i < p_; i++) {
-			pivots.push_back(samples.at(i * k));
-		}
+		std::vector<int> group_begin(p_ + 1);
+		std::iota(group_begin.begin(), group_begin.end(), 0);
+		std::vector<Tagged> pivots = selectSplitters(communicator_, group_begin);
 
+		/*
+		 * ======== Partition elements ========
+		 */
 		/** p_i will receive elements_per_processor[p_i] elements */
-		std::vector<int> elements_per_processor(p_, 0);
-		// Build logical partitioning of elements among processors
-		/** How many elements are yet to be assigned */
-		int elements_remaining = data_.size();
-		/** Next element to be assigned */
-		auto current_element = data_.begin();
-
-		for (unsigned pivot_ordinal { 0 };
-			 pivot_ordinal < pivots.size();
-			 pivot_ordinal++) {
-			while ((current_element != data_.end()) && (*current_element < pivots.at(pivot_ordinal))) {
-				elements_per_processor.at(pivot_ordinal)++;
-				elements_remaining--;
-				++current_element;
-			}
-		}
-
-		// All remaining elements go to the last processor
-		assert(elements_per_processor.at(p_ - 1) == 0);
-		elements_per_processor.at(p_ - 1) = elements_remaining;
+		std::vector<size_t> elements_per_processor = partition(pivots, rank_);
 
 		// Assert that all elements have been assigned somewhere
-		assert(std::accumulate(elements_per_processor.begin(), elements_per_processor.end(), 0) == (int) data_.size());
+		assert(std::accumulate(elements_per_processor.begin(), elements_per_processor.end(), size_t(0)) == data_.size());
 
 		/*
 		 * ======== Send elements to their processors ========
 		 */
 		// Communicate the number of elements that will be send from each processor to each other processor
 		/** This processor will receive elements_to_receive[i] elements from p_i */
-		std::vector<int> elements_to_receive(p_);
+		std::vector<size_t> elements_to_receive(p_);
 		MPI::Alltoall(
 				elements_per_processor.data(),
 				1,
-				MPI_INT,
+				MPI_SIZE_T,
 				elements_to_receive.data(),
 				1,
-				MPI_INT,
+				MPI_SIZE_T,
 				communicator_
 		);
 
 		// Now we can calculate the offsets for non-uniform receive
 		/** Displacements of the groups we will receive */
-		std::vector<int> arriving_elements_groups_offsets = MPIUtils::prefix_offsets(elements_to_receive);
+		std::vector<size_t> arriving_elements_groups_offsets = MPIUtils::prefix_offsets(elements_to_receive);
 		/** Displacements of our element groups */
-		std::vector<int> elements_groups_offsets = MPIUtils::prefix_offsets(elements_per_processor);
+		std::vector<size_t> elements_groups_offsets = MPIUtils::prefix_offsets(elements_per_processor);
 
 		/** How many elements we will get in total */
-		int number_of_elements_to_receive = std::accumulate(elements_to_receive.begin(), elements_to_receive.end(), 0);
+		size_t number_of_elements_to_receive = std::accumulate(elements_to_receive.begin(), elements_to_receive.end(), size_t(0));
 		/** Target buffer */
 		std::vector<ElementType> partitioned_data_slice(number_of_elements_to_receive);
 
 		// Yay finally
-		MPI::Alltoallv(
+		MPI::Alltoallv_large(
 				data_.data(),
 				elements_per_processor.data(),
 				elements_groups_offsets.data(),
-				element_type_,
 				partitioned_data_slice.data(),
 				elements_to_receive.data(),
 				arriving_elements_groups_offsets.data(),
@@ -173,10 +170,206 @@ public:
 				communicator_
 		);
 
-		std::sort(partitioned_data_slice.begin(), partitioned_data_slice.end());
+		measureImbalance(number_of_elements_to_receive);
+
+		// Et voila! Every processor has sent a sorted run
+		return multiway_merge(partitioned_data_slice, arriving_elements_groups_offsets);
+	}
+
+	/**
+	 * AMS-style multi-level sort. A level splits the current communicator into k ~ sqrt(q) groups of consecutive
+	 * ranks, partitions the elements among the groups by k - 1 splitters and continues within every group.
+	 * Communicators of at most `base_case_processors_` ranks are split into single ranks, which finishes the sort.
+	 *
+	 * Every rank exchanges data with about k others per level instead of all q, and the samples of a level only
+	 * need to separate k groups.
+	 */
+	std::vector<ElementType> sortMultiLevel() {
+		radix_sort(data_);
+
+		MPI_Comm level_communicator = communicator_;
+
+		while (true) {
+			int q, rank;
+			MPI_Comm_size(level_communicator, &q);
+			MPI_Comm_rank(level_communicator, &rank);
+
+			if (q == 1) {
+				break;
+			}
+
+			/** Groups are [group_begin[g], group_begin[g + 1]) */
+			int k = q <= int(base_case_processors_) ? q : int(std::round(std::sqrt(double(q))));
+			std::vector<int> group_begin(k + 1);
+			for (int g = 0; g <= k; g++) {
+				group_begin[g] = int(long(g) * q / k);
+			}
+			int own_group = int(std::upper_bound(group_begin.begin(), group_begin.end(), rank) - group_begin.begin()) - 1;
+			int own_group_size = group_begin[own_group + 1] - group_begin[own_group];
+
+			std::vector<Tagged> pivots = selectSplitters(level_communicator, group_begin);
+			std::vector<size_t> elements_per_group = partition(pivots, rank);
+			std::vector<size_t> elements_groups_offsets = MPIUtils::prefix_offsets(elements_per_group);
+
+			// Bucket g goes to one member of g, chosen so that every member hears from about q / |g| ranks
+			std::vector<int> destinations(k);
+			for (int g = 0; g < k; g++) {
+				destinations[g] = group_begin[g] + rank % (group_begin[g + 1] - group_begin[g]);
+			}
+			std::vector<int> sources;
+			for (int source = rank - group_begin[own_group]; source < q; source += own_group_size) {
+				sources.push_back(source);
+			}
+
+			std::vector<size_t> elements_to_receive(sources.size()), ones(std::max(size_t(k), sources.size()), 1);
+			std::vector<size_t> destination_offsets(k), source_offsets(sources.size());
+			std::iota(destination_offsets.begin(), destination_offsets.end(), 0);
+			std::iota(source_offsets.begin(), source_offsets.end(), 0);
+			MPI::Exchange_large(
+					elements_per_group.data(), destinations, ones.data(), destination_offsets.data(),
+					elements_to_receive.data(), sources, ones.data(), source_offsets.data(),
+					MPI_SIZE_T, level_communicator
+			);
+
+			std::vector<size_t> arriving_elements_offsets = MPIUtils::prefix_offsets(elements_to_receive);
+			std::vector<ElementType> received(std::accumulate(elements_to_receive.begin(), elements_to_receive.end(), size_t(0)));
+			MPI::Exchange_large(
+					data_.data(), destinations, elements_per_group.data(), elements_groups_offsets.data(),
+					received.data(), sources, elements_to_receive.data(), arriving_elements_offsets.data(),
+					element_type_, level_communicator
+			);
+
+			data_ = multiway_merge(received, arriving_elements_offsets);
+
+			MPI_Comm group_communicator;
+			MPI_Comm_split(level_communicator, own_group, rank, &group_communicator);
+			if (level_communicator != communicator_) {
+				MPI_Comm_free(&level_communicator);
+			}
+			level_communicator = group_communicator;
+		}
+
+		if (level_communicator != communicator_) {
+			MPI_Comm_free(&level_communicator);
+		}
+
+		measureImbalance(data_.size());
+
+		return std::move(data_);
+	}
+
+	/**
+	 * Collective on `communicator`. Takes oversampling * k equidistant samples of the sorted local data at every
+	 * processor, for k groups of consecutive ranks.
+	 *
+	 * @param group_begin The first rank of every group, followed by the communicator size
+	 * @return Pivots P_1, ..., P_{k - 1} for division among groups.
+	 * g_1 will get all elements e | e < P_1
+	 * g_2 will get all elements e | P_1 <= e < P_2
+	 * ...
+	 * g_k will get all elements e | P_{k - 1} <= e
+	 * where the elements are compared with their tags. The groups get shares proportional to their sizes.
+	 */
+	std::vector<Tagged> selectSplitters(MPI_Comm communicator, std::vector<int> const & group_begin) {
+		int q, rank;
+		MPI_Comm_size(communicator, &q);
+		MPI_Comm_rank(communicator, &rank);
+		size_t k = group_begin.size() - 1;
+
+		size_t samples_per_processor = std::min(data_.size(), size_t(oversampling_) * k);
+
+		std::vector<Tagged> local_samples;
+		for (size_t i = 0; i < samples_per_processor; i++) {
+			size_t index = (i + 1) * data_.size() / (samples_per_processor + 1);
+			local_samples.push_back({ data_[index], rank, index });
+		}
+
+		// Communicate all sample sizes, we will need a non-uniform all-gather
+		size_t local_sample_size = local_samples.size();
+		std::vector<size_t> sample_sizes(q);
+		MPI::Allgather(&local_sample_size, 1, MPI_SIZE_T, sample_sizes.data(), 1, MPI_SIZE_T, communicator);
+
+		std::vector<size_t> samples_offsets = MPIUtils::prefix_offsets(sample_sizes);
+		size_t total_sample_size = samples_offsets.back() + sample_sizes.back();
+
+		/** Global samples to be gathered */
+		std::vector<Tagged> samples(total_sample_size);
+
+		MPI_Datatype unpadded_type, tagged_type;
+		int blocklengths[3] = { 1, 1, 1 };
+		MPI_Datatype types[3] = { element_type_, MPI_INT, MPI_SIZE_T };
+		MPI_Aint offsets[3] = { offsetof(Tagged, element), offsetof(Tagged, rank), offsetof(Tagged, index) };
+		MPI_Type_create_struct(3, blocklengths, offsets, types, &unpadded_type);
+		MPI_Type_create_resized(unpadded_type, 0, sizeof(Tagged), &tagged_type);
+		MPI_Type_commit(&tagged_type);
+
+		MPI::Allgatherv_large(
+				local_samples.data(),
+				local_sample_size,
+				samples.data(),
+				sample_sizes.data(),
+				samples_offsets.data(),
+				tagged_type,
+				communicator
+		);
+
+		MPI_Type_free(&tagged_type);
+		MPI_Type_free(&unpadded_type);
+
+		std::sort(samples.begin(), samples.end());
+
+		std::vector<Tagged> pivots;
+		if (!samples.empty()) {
+			for (size_t g { 1 }; g < k; g++) {
+				pivots.push_back(samples.at(size_t(group_begin[g]) * total_sample_size / q));
+			}
+		}
+
+		return pivots;
+	}
+
+	/**
+	 * @param rank Our rank in the communicator the pivots were selected in
+	 * @return The number of (sorted) local elements that go to each of the pivots.size() + 1 parts
+	 */
+	std::vector<size_t> partition(std::vector<Tagged> const & pivots, int rank) const {
+		std::vector<size_t> elements_per_part(pivots.size() + 1, 0);
+
+		size_t previous = 0;
+		for (size_t i = 0; i < pivots.size(); i++) {
+			size_t bound = rankOf(pivots[i], rank);
+			elements_per_part[i] = bound - previous;
+			previous = bound;
+		}
+
+		// All remaining elements go to the last part
+		elements_per_part.back() += data_.size() - previous;
+
+		return elements_per_part;
+	}
+
+	/**
+	 * @return The number of local elements smaller than `pivot` (with the tags compared on ties)
+	 */
+	size_t rankOf(Tagged const & pivot, int rank) const {
+		auto equal_range = std::equal_range(data_.begin(), data_.end(), pivot.element);
+		size_t lower = size_t(equal_range.first - data_.begin()),
+			upper = size_t(equal_range.second - data_.begin());
+
+		if (rank < pivot.rank) {
+			return upper;
+		} else if (rank > pivot.rank) {
+			return lower;
+		} else {
+			return std::min(std::max(pivot.index, lower), upper);
+		}
+	}
 
-		// Et voila!
-		return partitioned_data_slice;
+	void measureImbalance(size_t slice_size) {
+		size_t largest, total;
+		MPI::Allreduce(&slice_size, &largest, 1, MPI_SIZE_T, MPI_MAX, communicator_);
+		MPI::Allreduce(&slice_size, &total, 1, MPI_SIZE_T, MPI_SUM, communicator_);
+		imbalance_ = total == 0 ? 1 : double(largest) * p_ / total;
 	}
 };
 
@@ -24,6 +24,50 @@ std::vector<int> MPIUtils::prefix_intervals(const std::vector<int> & sizes) {
 	return offsets; // NRVO
 }
 
+std::vector<size_t> MPIUtils::prefix_offsets(const std::vector<size_t> & sizes) {
+	std::vector<size_t> offsets;
+	offsets.push_back(0);
+	std::partial_sum(
+			sizes.begin(),
+			--sizes.end(),
+			std::back_inserter(offsets)
+	);
+	return offsets; // NRVO
+}
+
+std::vector<size_t> MPIUtils::prefix_intervals(const std::vector<size_t> & sizes) {
+	std::vector<size_t> offsets;
+	offsets.push_back(0);
+	std::partial_sum(
+			sizes.begin(),
+			sizes.end(),
+			std::back_inserter(offsets)
+	);
+	return offsets; // NRVO
+}
+
+std::map<std::string, std::string> ArgUtils::extractOptions(int & argc, char * argv[]) {
+	std::map<std::string, std::string> options;
+	int positional = 1;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument(argv[i]);
+
+		if (argument.compare(0, 2, "--") == 0) {
+			size_t separator = argument.find('=');
+			if (separator == std::string::npos) {
+				options[argument.substr(2)] = "";
+			} else {
+				options[argument.substr(2, separator - 2)] = argument.substr(separator + 1);
+			}
+		} else {
+			argv[positional++] = argv[i];
+		}
+	}
+
+	argc = positional;
+	return options;
+}
 
 void CacheUtils::trashCache(unsigned cache_size) {
 	// Trashe le cache
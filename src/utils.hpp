@@ -7,6 +7,7 @@
 #include <string>
 #include <functional>
 #include <iomanip>
+#include <map>
 
 template<typename OutStream, typename T>
 OutStream& operator<< (OutStream& out, const std::vector<T>& v)
@@ -105,12 +106,27 @@ namespace MPIUtils {
 	 */
 	std::vector<int> prefix_offsets(const std::vector<int> & sizes);
 
+	/** Large-count version, for the MPI::*_large collectives */
+	std::vector<size_t> prefix_offsets(const std::vector<size_t> & sizes);
+
 	/**
 	 * Calculate interval specification for CSR-style interval sepcification
 	 * @param sizes
 	 * @return Memory offsets of groups of elements of the give `sizes`
 	 */
 	std::vector<int> prefix_intervals(const std::vector<int> & sizes);
+
+	std::vector<size_t> prefix_intervals(const std::vector<size_t> & sizes);
+}
+
+namespace ArgUtils {
+	/**
+	 * Remove all `--key=value` (or bare `--key`) arguments from argv, leaving the positional ones in place
+	 * @param [in,out] argc
+	 * @param [in,out] argv
+	 * @return The extracted options. Bare flags map to an empty string
+	 */
+	std::map<std::string, std::string> extractOptions(int & argc, char * argv[]);
 }
 
 namespace CacheUtils {